@@ -0,0 +1,102 @@
+/*! \file fixtures.h
+ *  \brief Fixed date gamestate setups shared by the benchmarks.
+ *
+ * Included right after date.c, as it reaches into its internals.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLINDDATE_FIXTURES_H
+#define BLINDDATE_FIXTURES_H
+
+static char *line __attribute__((unused)) = "I've never been on a date before. Is it always this dark, or did somebody forget to pay the bills?";
+
+static void Progress(struct Game *game) {}
+
+static inline void StartDrawing(struct Game *game, struct GamestateResources *data, int symbol) {
+	// Sets the symbol up like the Draw action does and scribbles a zigzag over the whole canvas,
+	// so the canvas, the meter and the scorers all have something to work with.
+	RequireResident(game, &data->residents[symbol]);
+	data->drawbmp = data->symbols[symbol];
+	data->drawfield = data->fields[symbol];
+	data->stroke_count = 0;
+	ResetMeter(data);
+
+	ALLEGRO_BITMAP *target = al_get_target_bitmap();
+	al_set_target_bitmap(data->canvas);
+	al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+	al_set_target_bitmap(target);
+	float w = al_get_bitmap_width(data->canvas), h = al_get_bitmap_height(data->canvas);
+	data->x = w / 18.0;
+	data->y = h * 0.2;
+	for (int i = 0; i < 16; i++) {
+		float x = w * (i + 2) / 18.0, y = h * ((i % 2) ? 0.2 : 0.8);
+		DrawStrokeSegment(data, x, y);
+		data->x = x;
+		data->y = y;
+	}
+	while (data->meter_segments < data->stroke_count) {
+		UpdateMeter(data);
+	}
+	data->meter_time = 0; // it took more than one frame's worth of budget, as it would in the game
+
+	data->drawing = true;
+	data->time = 60*6;
+	data->timeleft = data->time / 2;
+	data->touch = false;
+	data->x = w / 2;
+	data->y = h / 2;
+}
+
+static inline int SymbolForStage(struct GamestateResources *data, int stage) {
+	// the symbol the dialogue would ask for around this stage
+	int symbol = 0;
+	for (int i = 0; i < DIALOGUE_SYMBOL_COUNT; i++) {
+		if ((data->residents[i].from <= stage) && (data->residents[i].to >= stage)) {
+			symbol = i;
+		}
+	}
+	return symbol;
+}
+
+static inline void Animate(struct Game *game, struct GamestateResources *data) {
+	// what Gamestate_Logic would do, minus the timeline and streaming, with the pointer moving while drawing
+	data->blink_counter = (data->blink_counter + 1) % 60;
+	data->rand = rand() / (float)RAND_MAX / 4.0 + 0.75;
+	if (data->end) {
+		data->hearts += 0.01;
+		data->heart1 -= 0.01;
+		data->heart2 -= 0.01;
+		if (data->heart2 < -0.2) {
+			data->heart1 += 1.7;
+			data->heart2 += 1.7;
+		}
+	}
+	if (data->drawing && (data->stroke_count < STROKE_SEGMENTS)) {
+		// circling around the middle of the canvas, as if the pointer never stopped
+		float w = al_get_bitmap_width(data->canvas), h = al_get_bitmap_height(data->canvas);
+		float x = w * (0.5 + 0.3 * cos(data->stroke_count * 0.2)), y = h * (0.5 + 0.3 * sin(data->stroke_count * 0.2));
+		DrawStrokeSegment(data, x, y);
+		data->x = x;
+		data->y = y;
+		UpdateMeter(data);
+	}
+	AnimateCharacter(game, data->fire, 1);
+	AnimateCharacter(game, data->warthog, 1);
+}
+
+#endif
@@ -0,0 +1,226 @@
+/*! \file gate.c
+ *  \brief Performance regression test against a checked-in baseline.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../src/gamestates/date.c"
+#include <stdio.h>
+#include <sys/resource.h>
+#include "headless.h"
+#include "fixtures.h"
+
+#define WIDTH 1280
+#define HEIGHT 720
+#define LOAD_RUNS 3
+#define SCORE_OPS 200
+#define SCORE_RUNS 5
+#define FRAMES 60
+
+/*! \brief Single measured value along with what it's checked against. */
+struct Metric {
+		char *name;
+		char *unit;
+		double tolerance; /*!< How much it may grow over the baseline, as a fraction of it; overridden by the baseline file. */
+		double baseline; /*!< Zero when the baseline file doesn't have it, which fails the gate. */
+		double value;
+};
+
+enum {
+	METRIC_LOAD,
+	METRIC_SCORE,
+	METRIC_FRAME,
+	METRIC_MEMORY,
+	METRIC_COUNT
+};
+
+static struct Metric metrics[METRIC_COUNT] = {
+	{ "load_ms", "ms", 0.5, 0, 0 },
+	{ "score_us", "us", 0.5, 0, 0 },
+	{ "frame_ms", "ms", 0.3, 0, 0 },
+	{ "peak_memory_kb", "kB", 0.2, 0, 0 }
+};
+
+static int CompareDoubles(const void *a, const void *b) {
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+static bool ReadBaseline(const char *filename) {
+	// one "name value tolerance" line per metric, # starts a comment
+	FILE *file = fopen(filename, "r");
+	if (!file) {
+		return false;
+	}
+	char buf[256];
+	while (fgets(buf, sizeof(buf), file)) {
+		char name[64];
+		double value, tolerance;
+		if ((buf[0] == '#') || (sscanf(buf, "%63s %lf %lf", name, &value, &tolerance) != 3)) {
+			continue;
+		}
+		for (int i = 0; i < METRIC_COUNT; i++) {
+			if (!strcmp(metrics[i].name, name)) {
+				metrics[i].baseline = value;
+				metrics[i].tolerance = tolerance;
+			}
+		}
+	}
+	fclose(file);
+	return true;
+}
+
+static bool WriteBaseline(const char *filename) {
+	FILE *file = fopen(filename, "w");
+	if (!file) {
+		return false;
+	}
+	fprintf(file, "# Baseline of the perf-gate test (benchmarks/gate.c), measured headless at %dx%d.\n", WIDTH, HEIGHT);
+	fprintf(file, "# Update with -DBLINDDATE_PERF_UPDATE_BASELINE=ON and a ctest run, on the machine that runs the gate.\n");
+	fprintf(file, "# The tolerance is how much a metric may grow over the baseline, as a fraction of it.\n");
+	fprintf(file, "# A metric that's missing or 0 fails the gate until it's recorded.\n");
+	fprintf(file, "# metric         value        tolerance\n");
+	for (int i = 0; i < METRIC_COUNT; i++) {
+		fprintf(file, "%-16s %-12.3f %.2f\n", metrics[i].name, metrics[i].value, metrics[i].tolerance);
+	}
+	fclose(file);
+	return true;
+}
+
+static double MeasureLoad(struct Game *game) {
+	// median of a few full load and unload cycles, each with nothing preloaded or cached
+	double times[LOAD_RUNS];
+	for (int i = 0; i < LOAD_RUNS; i++) {
+		double start = al_get_time();
+		struct GamestateResources *data = Gamestate_Load(game, Progress);
+		times[i] = al_get_time() - start;
+		Gamestate_Unload(game, data);
+		TrimCache(game, 0); // or the next one would find most of it in the cache
+	}
+	qsort(times, LOAD_RUNS, sizeof(double), CompareDoubles);
+	return times[LOAD_RUNS / 2] * 1000;
+}
+
+static double MeasureScore(struct Game *game, struct GamestateResources *data) {
+	// the distance scoring done on a worker after every drawing, on a zigzag over a symbol
+	StartDrawing(game, data, 0);
+	double times[SCORE_RUNS];
+	for (int r = 0; r < SCORE_RUNS; r++) {
+		double start = al_get_time();
+		for (int i = 0; i < SCORE_OPS; i++) {
+			CalculateDistanceScore(data);
+		}
+		times[r] = (al_get_time() - start) / SCORE_OPS;
+	}
+	qsort(times, SCORE_RUNS, sizeof(double), CompareDoubles);
+	return times[SCORE_RUNS / 2] * 1000000;
+}
+
+static double MeasureFrame(struct Game *game, struct GamestateResources *data, ALLEGRO_BITMAP *frame) {
+	// mean over a dialogue frame and a drawing frame of the middle stage
+	double sum = 0;
+	for (int scenario = 0; scenario < 2; scenario++) {
+		data->stage = 3;
+		data->text = line;
+		data->player = true;
+		data->drawing = false;
+		if (scenario) {
+			data->text = NULL;
+			StartDrawing(game, data, SymbolForStage(data, data->stage));
+		}
+		for (int i = 0; i < FRAMES; i++) {
+			Animate(game, data);
+			al_set_target_bitmap(frame);
+			al_clear_to_color(al_map_rgb(0, 0, 0));
+			double start = al_get_time();
+			Gamestate_Draw(game, data);
+			sum += al_get_time() - start;
+		}
+	}
+	return sum / (FRAMES * 2) * 1000;
+}
+
+int main(int argc, char** argv) {
+	bool update = (argc > 2) && !strcmp(argv[1], "--update");
+	if ((argc != 2) && !update) {
+		fprintf(stderr, "Usage: %s [--update] baseline-file\n", argv[0]);
+		return 1;
+	}
+	const char *filename = argv[argc - 1];
+	if (!ReadBaseline(filename) && !update) {
+		fprintf(stderr, "Could not read %s; record it with -DBLINDDATE_PERF_UPDATE_BASELINE=ON and a ctest run.\n", filename);
+		return 1;
+	}
+
+	srand(0);
+	struct Game *game = CreateHeadlessGame(WIDTH, HEIGHT);
+	if (!game) {
+		return 1;
+	}
+	ALLEGRO_BITMAP *frame = al_create_bitmap(WIDTH, HEIGHT);
+	al_set_target_bitmap(frame);
+
+	metrics[METRIC_LOAD].value = MeasureLoad(game);
+	struct GamestateResources *data = Gamestate_Load(game, Progress);
+	Gamestate_Start(game, data);
+	metrics[METRIC_SCORE].value = MeasureScore(game, data);
+	metrics[METRIC_FRAME].value = MeasureFrame(game, data, frame);
+	double meter_peak = data->meter_peak; // over the drawing frames, which MeasureFrame ends with
+	Gamestate_Stop(game, data);
+
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	metrics[METRIC_MEMORY].value = usage.ru_maxrss; // in kilobytes on Linux
+
+	StopGameData(game, game->data);
+	Gamestate_Unload(game, data);
+	al_destroy_bitmap(frame);
+	DestroyHeadlessGame(game);
+
+	// not a baseline, but the budget the meter is written to keep to
+	bool meter_ok = meter_peak <= METER_BUDGET;
+	printf("%-16s %12.3f us, budget %.3f: %s\n", "meter_peak_us", meter_peak * 1000000, METER_BUDGET * 1000000,
+	       meter_ok ? "ok" : "OVER BUDGET");
+
+	if (update) {
+		if (!WriteBaseline(filename)) {
+			fprintf(stderr, "Could not write %s.\n", filename);
+			return 1;
+		}
+		for (int i = 0; i < METRIC_COUNT; i++) {
+			printf("%-16s %12.3f %s (baseline updated)\n", metrics[i].name, metrics[i].value, metrics[i].unit);
+		}
+		return 0;
+	}
+
+	int failed = !meter_ok;
+	for (int i = 0; i < METRIC_COUNT; i++) {
+		struct Metric *metric = &metrics[i];
+		if (metric->baseline <= 0) {
+			// a gate that can't fail is no gate, so it has to be recorded first
+			printf("%-16s %12.3f %s, no baseline: FAILED\n", metric->name, metric->value, metric->unit);
+			failed++;
+			continue;
+		}
+		double limit = metric->baseline * (1 + metric->tolerance);
+		bool ok = metric->value <= limit;
+		printf("%-16s %12.3f %s, baseline %.3f, limit %.3f: %s\n", metric->name, metric->value, metric->unit,
+		       metric->baseline, limit, ok ? "ok" : "REGRESSED");
+		failed += !ok;
+	}
+	return failed ? 1 : 0;
+}
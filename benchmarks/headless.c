@@ -0,0 +1,58 @@
+/*! \file headless.c
+ *  \brief Game set up without a display, for the benchmarks.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include "../src/common.h"
+#include <libsuperderpy.h>
+#include "headless.h"
+
+static ALLEGRO_MIXER* CreateMixer(void) {
+	return al_create_mixer(44100, ALLEGRO_AUDIO_DEPTH_FLOAT32, ALLEGRO_CHANNEL_CONF_2);
+}
+
+struct Game* CreateHeadlessGame(int width, int height) {
+	if (!al_init() || !al_init_image_addon() || !al_init_font_addon() || !al_init_ttf_addon() || !al_init_primitives_addon()) {
+		fprintf(stderr, "Could not initialize Allegro.\n");
+		return NULL;
+	}
+	// there may be no sound card either; the streams only need mixers to be attached to
+	al_install_audio();
+	al_init_acodec_addon();
+
+	struct Game *game = calloc(1, sizeof(struct Game));
+	game->viewport.width = width;
+	game->viewport.height = height;
+	game->audio.mixer = CreateMixer();
+	game->audio.music = CreateMixer();
+	game->audio.voice = CreateMixer();
+	game->audio.fx = CreateMixer();
+	game->data = CreateGameData(game);
+	return game;
+}
+
+void DestroyHeadlessGame(struct Game *game) {
+	// StopGameData has to be called by then, before the gamestates are unloaded
+	DestroyGameData(game->data);
+	al_destroy_mixer(game->audio.fx);
+	al_destroy_mixer(game->audio.voice);
+	al_destroy_mixer(game->audio.music);
+	al_destroy_mixer(game->audio.mixer);
+	free(game);
+}
@@ -0,0 +1,34 @@
+/*! \file headless.h
+ *  \brief Game set up without a display, for the benchmarks.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLINDDATE_HEADLESS_H
+#define BLINDDATE_HEADLESS_H
+
+struct Game;
+
+/*! \brief Initializes Allegro and fills in just enough of struct Game for the gamestates to load and draw.
+ *
+ * No display is ever created, so every bitmap is a memory bitmap and all
+ * drawing goes through Allegro's software renderer. It's slow, but it runs
+ * anywhere and still shows when something gets more expensive. */
+struct Game* CreateHeadlessGame(int width, int height);
+void DestroyHeadlessGame(struct Game *game);
+
+#endif
@@ -0,0 +1,99 @@
+/*! \file inject.c
+ *  \brief Input-to-photon latency of the drawing under synthetic input.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+// Built with BLINDDATE_LATENCY whatever the option is set to, see CMakeLists.txt.
+#include "../src/gamestates/date.c"
+#include <stdio.h>
+#include "headless.h"
+#include "fixtures.h"
+
+#define DEFAULT_FRAMES 300
+#define FPS 60
+#define INPUT_RATE 125 // Hz, what most mice report at
+
+static void Inject(struct Game *game, struct GamestateResources *data, int i, double timestamp) {
+	// a pointer going round in circles with the button held, as the events would come from the queue
+	ALLEGRO_EVENT ev = { .type = ALLEGRO_EVENT_MOUSE_AXES };
+	ev.any.timestamp = timestamp;
+	ev.mouse.x = game->viewport.width * (0.5 + 0.3 * cos(i * 0.05));
+	ev.mouse.y = game->viewport.height * (0.5 + 0.3 * sin(i * 0.05));
+	Gamestate_ProcessEvent(game, data, &ev);
+}
+
+int main(int argc, char** argv) {
+	const char *filename = (argc > 1) ? argv[1] : "latency.json";
+	int frames = (argc > 2) ? atoi(argv[2]) : DEFAULT_FRAMES;
+	if ((argc > 3) || (frames <= 0)) {
+		fprintf(stderr, "Usage: %s [report.json] [frames]\n", argv[0]);
+		return 1;
+	}
+
+	srand(0);
+	struct Game *game = CreateHeadlessGame(1280, 720);
+	if (!game) {
+		return 1;
+	}
+	ALLEGRO_BITMAP *frame = al_create_bitmap(game->viewport.width, game->viewport.height);
+	al_set_target_bitmap(frame);
+
+	struct GamestateResources *data = Gamestate_Load(game, Progress);
+	Gamestate_Start(game, data);
+	data->stage = 3;
+	StartDrawing(game, data, SymbolForStage(data, data->stage));
+	data->button = true;
+
+	// Inputs and frames are interleaved in real time, like in the engine's event loop, so each input waits
+	// for the next frame just as it would there. There's no display to flip, so a frame counts as shown once
+	// it's drawn into the memory bitmap, and the report's present part stays at zero; the wait for the frame
+	// to come up and the drawing are reported apart, as most of the total is the former.
+	double now = al_get_time(), next_input = now, next_frame = now + 1.0 / FPS, draw_time = 0;
+	int inputs = 0;
+	for (int f = 0; f < frames;) {
+		now = al_get_time();
+		if (now >= next_input) {
+			Inject(game, data, inputs++, now);
+			next_input += 1.0 / INPUT_RATE;
+			continue;
+		}
+		if (now >= next_frame) {
+			Animate(game, data);
+			data->timeleft = data->time; // so the drawing never runs out
+			al_set_target_bitmap(frame);
+			al_clear_to_color(al_map_rgb(0, 0, 0));
+			Gamestate_Draw(game, data); // LATENCY_FRAME and LATENCY_DRAWN are in there
+			LATENCY_SHOWN(al_get_time());
+			draw_time += al_get_time() - now;
+			next_frame += 1.0 / FPS;
+			f++;
+			continue;
+		}
+		al_rest(fmin(next_input, next_frame) - now);
+	}
+	printf("%d inputs over %d frames, %.3f ms per frame drawn\n", inputs, frames, draw_time / frames * 1000);
+
+	Gamestate_Stop(game, data);
+	StopGameData(game, game->data);
+	Gamestate_Unload(game, data);
+	al_destroy_bitmap(frame);
+	DestroyHeadlessGame(game);
+	LATENCY_WRITE(filename);
+	return 0;
+}
@@ -0,0 +1,216 @@
+/*! \file micro.c
+ *  \brief Microbenchmarks of the game's hot paths.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Like the render benchmark, this one has the date gamestate built right in to get at its internals.
+#include "../src/gamestates/date.c"
+#include <stdio.h>
+#include <time.h>
+#include "headless.h"
+#include "fixtures.h"
+
+#define REPEATS 5
+
+#ifdef __GLIBC__
+// Every allocation made while a benchmark runs is counted, from whatever library or thread it comes.
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t nmemb, size_t size);
+extern void* __libc_realloc(void *ptr, size_t size);
+
+static int counting;
+static long allocs, allocated;
+
+static void CountAllocation(size_t size) {
+	if (__atomic_load_n(&counting, __ATOMIC_RELAXED)) {
+		__atomic_add_fetch(&allocs, 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&allocated, size, __ATOMIC_RELAXED);
+	}
+}
+
+void* malloc(size_t size) {
+	CountAllocation(size);
+	return __libc_malloc(size);
+}
+
+void* calloc(size_t nmemb, size_t size) {
+	CountAllocation(nmemb * size);
+	return __libc_calloc(nmemb, size);
+}
+
+void* realloc(void *ptr, size_t size) {
+	CountAllocation(size);
+	return __libc_realloc(ptr, size);
+}
+#define ALLOCATIONS_COUNTED true
+#else
+static int counting;
+static long allocs, allocated;
+#define ALLOCATIONS_COUNTED false
+#endif
+
+struct Context {
+		struct Game *game;
+		struct GamestateResources *data;
+		ALLEGRO_BITMAP *frame, *light;
+		char *voice;
+		int i;
+};
+
+struct Benchmark {
+		char *name;
+		int ops; // per repeat, picked so that each takes roughly the same time
+		void (*run)(struct Context *ctx);
+};
+
+static void BenchCalculateScore(struct Context *ctx) {
+	CalculateScore(ctx->game, ctx->data);
+}
+
+static void BenchCalculateDistanceScore(struct Context *ctx) {
+	CalculateDistanceScore(ctx->data);
+}
+
+static void BenchGenerateLight(struct Context *ctx) {
+	GenerateLight(ctx->light, 128);
+}
+
+static void BenchDrawStrokeSegment(struct Context *ctx) {
+	// back and forth across the canvas in 20 pixel steps, like a quick scribble
+	struct GamestateResources *data = ctx->data;
+	float x = 100 + (ctx->i % 20) * 20, y = (ctx->i % 2) ? 120 : 140;
+	if (data->stroke_count == STROKE_SEGMENTS) {
+		data->stroke_count = 0;
+	}
+	DrawStrokeSegment(data, x, y);
+	data->x = x;
+	data->y = y;
+	ctx->i++;
+}
+
+static void BenchSwitchSpritesheet(struct Context *ctx) {
+	static char *names[] = { "1", "2", "3" };
+	SwitchSpritesheet(ctx->game, ctx->data->warthog, names[ctx->i++ % 3]);
+}
+
+static void BenchWrappedTextWithShadow(struct Context *ctx) {
+	al_set_target_bitmap(ctx->frame);
+	WrappedTextWithShadow(ctx->game, ctx->data->smallfont, al_map_rgba_f(1,1,1,1), ctx->game->viewport.width * 0.05,
+	                      ctx->game->viewport.height * 0.85, ctx->game->viewport.width * 0.9, ALLEGRO_ALIGN_CENTER, line);
+}
+
+static void BenchVoiceOpen(struct Context *ctx) {
+	al_destroy_audio_stream(al_load_audio_stream(ctx->voice, 4, 1024));
+}
+
+static void BenchVoiceDecode(struct Context *ctx) {
+	al_destroy_sample(al_load_sample(ctx->voice));
+}
+
+static struct Benchmark benchmarks[] = {
+	{ "CalculateScore", 20, BenchCalculateScore },
+	{ "CalculateDistanceScore", 200, BenchCalculateDistanceScore },
+	{ "GenerateLight", 10, BenchGenerateLight },
+	{ "DrawStrokeSegment", 2000, BenchDrawStrokeSegment },
+	{ "SwitchSpritesheet", 100000, BenchSwitchSpritesheet },
+	{ "WrappedTextWithShadow", 200, BenchWrappedTextWithShadow },
+	{ "voice stream open", 20, BenchVoiceOpen },
+	{ "voice decode", 5, BenchVoiceDecode }
+};
+
+static double Now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int CompareDoubles(const void *a, const void *b) {
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+int main(int argc, char** argv) {
+	FILE *out = stdout;
+	if (argc > 1) {
+		out = fopen(argv[1], "w");
+		if (!out) {
+			fprintf(stderr, "Could not open %s for writing.\n", argv[1]);
+			return 1;
+		}
+	}
+
+	srand(0);
+	struct Game *game = CreateHeadlessGame(1280, 720);
+	if (!game) {
+		return 1;
+	}
+
+	struct Context ctx = { .game = game };
+	ctx.frame = al_create_bitmap(game->viewport.width, game->viewport.height);
+	ctx.light = al_create_bitmap(320*2, 180*2);
+	al_set_target_bitmap(ctx.frame);
+	ctx.data = Gamestate_Load(game, Progress);
+	Gamestate_Start(game, ctx.data);
+	ctx.voice = strdup(GetDataFilePath(game, "voices/greg-01.flac"));
+
+	// the first symbol, with a zigzag drawn over it, for both of the scorers
+	StartDrawing(game, ctx.data, 0);
+
+	fprintf(out, "{\n\t\"allocations_counted\": %s,\n\t\"benchmarks\": [\n", ALLOCATIONS_COUNTED ? "true" : "false");
+	size_t count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+	for (size_t b = 0; b < count; b++) {
+		struct Benchmark *bench = &benchmarks[b];
+		double times[REPEATS];
+		long bench_allocs = 0, bench_allocated = 0;
+
+		bench->run(&ctx); // warm up caches, lazily created glyphs and such
+		for (int r = 0; r < REPEATS; r++) {
+			allocs = 0;
+			allocated = 0;
+			__atomic_store_n(&counting, 1, __ATOMIC_RELAXED);
+			double start = Now();
+			for (int i = 0; i < bench->ops; i++) {
+				bench->run(&ctx);
+			}
+			times[r] = (Now() - start) / bench->ops;
+			__atomic_store_n(&counting, 0, __ATOMIC_RELAXED);
+			bench_allocs += allocs;
+			bench_allocated += allocated;
+		}
+		qsort(times, REPEATS, sizeof(double), CompareDoubles);
+
+		long ops = (long)bench->ops * REPEATS;
+		fprintf(out, "\t\t{ \"name\": \"%s\", \"ops\": %ld, \"ns_per_op\": %.1f, \"min_ns_per_op\": %.1f, "
+		        "\"allocs_per_op\": %.2f, \"bytes_per_op\": %.1f }%s\n", bench->name, ops, times[REPEATS / 2], times[0],
+		        bench_allocs / (double)ops, bench_allocated / (double)ops, (b + 1 < count) ? "," : "");
+		fprintf(stderr, "%-24s %14.1f ns/op %10.2f allocs/op\n", bench->name, times[REPEATS / 2], bench_allocs / (double)ops);
+	}
+	fprintf(out, "\t]\n}\n");
+	if (out != stdout) {
+		fclose(out);
+	}
+
+	free(ctx.voice);
+	Gamestate_Stop(game, ctx.data);
+	StopGameData(game, game->data);
+	Gamestate_Unload(game, ctx.data);
+	al_destroy_bitmap(ctx.light);
+	al_destroy_bitmap(ctx.frame);
+	DestroyHeadlessGame(game);
+	return 0;
+}
@@ -0,0 +1,23 @@
+#!/bin/sh
+# Profile-guided build of the static executable:
+# instruments it, collects profiles from a scripted headless run of the date (train.c) and rebuilds with them.
+# Usage: benchmarks/pgo.sh [build-dir] [frames]
+set -e
+
+SOURCE_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_DIR=${1:-"$SOURCE_DIR/build-pgo"}
+FRAMES=${2:-7200}
+
+mkdir -p "$BUILD_DIR"
+cd "$BUILD_DIR"
+BUILD_DIR=$(pwd)
+
+cmake "$SOURCE_DIR" -DCMAKE_BUILD_TYPE=Release -DBLINDDATE_STATIC=ON -DBLINDDATE_PGO=GENERATE -DBLINDDATE_PGO_DIR="$BUILD_DIR/pgo"
+rm -rf "$BUILD_DIR/pgo"
+cmake --build . --target pgo-train
+
+# from the source tree, so the data files are found
+(cd "$SOURCE_DIR" && "$BUILD_DIR/benchmarks/pgo-train" "$FRAMES")
+
+cmake "$SOURCE_DIR" -DBLINDDATE_PGO=USE
+cmake --build .
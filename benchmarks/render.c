@@ -0,0 +1,173 @@
+/*! \file render.c
+ *  \brief Headless benchmark of the date gamestate's rendering.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// The gamestate is built right into the benchmark, so every stage can be set up without playing through it.
+#include "../src/gamestates/date.c"
+#include <stdio.h>
+#include "headless.h"
+#include "fixtures.h"
+
+#define DEFAULT_FRAMES 100
+#define WARMUP_FRAMES 5
+
+struct Scenario {
+		char *name;
+		int stage;
+		bool drawing, end;
+		char *text;
+		bool player;
+};
+
+static struct Scenario scenarios[] = {
+	{ "title", 0, false, false, NULL, false },
+	{ "stage 1", 1, false, false, "Hi!", true },
+	{ "stage 2", 2, false, false, NULL, false },
+	{ "stage 3", 3, false, false, NULL, true },
+	{ "stage 4", 4, false, false, NULL, false },
+	{ "stage 5", 5, false, false, NULL, true },
+	{ "stage 1 drawing", 1, true, false, NULL, false },
+	{ "stage 2 drawing", 2, true, false, NULL, false },
+	{ "stage 3 drawing", 3, true, false, NULL, false },
+	{ "stage 4 drawing", 4, true, false, NULL, false },
+	{ "stage 5 drawing", 5, true, false, NULL, false },
+	{ "end", 5, false, true, NULL, false }
+};
+
+static void SetupScenario(struct Game *game, struct GamestateResources *data, struct Scenario *scenario) {
+	data->stage = scenario->stage;
+	data->end = scenario->end;
+	data->text = scenario->text;
+	if ((scenario->stage > 1) && !scenario->drawing && !scenario->end) {
+		data->text = line;
+	}
+	data->player = scenario->player;
+	data->drawing = false;
+
+	if (data->stage == 5) {
+		RequireResident(game, &data->residents[RESIDENT_HAPPY]);
+		SelectSpritesheet(game, data->warthog, "happy");
+	}
+
+	if (scenario->drawing) {
+		StartDrawing(game, data, SymbolForStage(data, data->stage));
+	}
+}
+
+static double MeasureInteractive(struct Game *game, ALLEGRO_BITMAP *frame, struct GamestateResources **data) {
+	// from nothing loaded or cached to the first frame the player can draw on, which is what the logged
+	// "Date interactive" and the "date: interactive" trace event measure in the game
+	TrimCache(game, 0);
+	double time = al_get_time();
+	*data = Gamestate_Load(game, Progress);
+	Gamestate_Start(game, *data);
+	al_set_target_bitmap(frame);
+	Gamestate_Draw(game, *data);
+	return al_get_time() - time;
+}
+
+int main(int argc, char** argv) {
+	int frames = (argc > 1) ? atoi(argv[1]) : DEFAULT_FRAMES;
+	int width = (argc > 2) ? atoi(argv[2]) : 1280;
+	int height = (argc > 3) ? atoi(argv[3]) : 720;
+	if ((frames <= 0) || (width <= 0) || (height <= 0)) {
+		fprintf(stderr, "Usage: %s [frames] [width] [height]\n", argv[0]);
+		return 1;
+	}
+
+	srand(0);
+	struct Game *game = CreateHeadlessGame(width, height);
+	if (!game) {
+		return 1;
+	}
+
+	ALLEGRO_BITMAP *frame = al_create_bitmap(width, height);
+	al_set_target_bitmap(frame);
+
+	struct GamestateResources *data;
+	double interactive = MeasureInteractive(game, frame, &data);
+	Gamestate_Stop(game, data);
+	Gamestate_Unload(game, data);
+
+	TrimCache(game, 0);
+	double time = al_get_time();
+	data = Gamestate_Load(game, Progress);
+	double load = al_get_time() - time;
+	time = al_get_time();
+	Gamestate_Start(game, data);
+	double start = al_get_time() - time;
+
+	printf("date at %dx%d, %d frames per scenario\n", width, height, frames);
+	printf("%-16s %10s\n", "load", "");
+	printf("%-16s %10.3f ms\n", "  Gamestate_Load", load * 1000);
+	printf("%-16s %10.3f ms\n", "  Gamestate_Start", start * 1000);
+	printf("%-16s %10.3f ms (%d decoding threads)\n", "  interactive", interactive * 1000, GetJobThreadCount(game->data->jobs));
+	printf("%-16s %10s %10s %10s %8s %8s\n", "scenario", "fps", "mean ms", "max ms", "draws", "changes");
+
+	double total = 0;
+	int count = 0;
+	for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+		struct Scenario *scenario = &scenarios[i];
+		SetupScenario(game, data, scenario);
+
+		double sum = 0, peak = 0;
+		int draws = 0, changes = 0;
+		for (int f = -WARMUP_FRAMES; f < frames; f++) {
+			Animate(game, data);
+			al_set_target_bitmap(frame);
+			al_clear_to_color(al_map_rgb(0, 0, 0));
+
+			time = al_get_time();
+			Gamestate_Draw(game, data);
+			time = al_get_time() - time;
+
+			if (f < 0) {
+				continue;
+			}
+			sum += time;
+			if (time > peak) {
+				peak = time;
+			}
+			draws += data->draw_calls;
+			changes += data->state_changes;
+		}
+		printf("%-16s %10.1f %10.3f %10.3f %8.1f %8.1f\n", scenario->name, frames / sum, sum / frames * 1000, peak * 1000,
+		       draws / (float)frames, changes / (float)frames);
+		if (scenario->drawing) {
+			printf("%-16s %10.3f us peak per frame%s\n", "  meter", data->meter_peak * 1000000,
+			       (data->meter_peak > METER_BUDGET) ? ", OVER BUDGET" : "");
+		}
+		total += sum;
+		count += frames;
+	}
+	printf("%-16s %10.1f %10.3f\n", "overall", count / total, total / count * 1000);
+
+	Gamestate_Stop(game, data);
+	StopGameData(game, game->data);
+	Gamestate_Unload(game, data);
+
+	// with the workers stopped everything is decoded on the calling thread, as before the loader had any
+	interactive = MeasureInteractive(game, frame, &data);
+	printf("%-16s %10.3f ms (decoded serially)\n", "  interactive", interactive * 1000);
+	Gamestate_Stop(game, data);
+	Gamestate_Unload(game, data);
+	al_destroy_bitmap(frame);
+	DestroyHeadlessGame(game);
+	return 0;
+}
@@ -0,0 +1,155 @@
+/*! \file train.c
+ *  \brief Scripted headless playthrough collecting the profiles of the PGO build.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "../src/common.h"
+#include "../src/static.h"
+#include <libsuperderpy.h>
+#include "headless.h"
+
+// Unlike the benchmarks, this one goes through the exported entry points of the date as linked into the game
+// (see src/static.h), so that the profiles are recorded against the very same objects the executable is built from.
+
+#define DEFAULT_FRAMES 7200
+#define ROUND_FRAMES 3600 // restarted every so often, in case it got to the end
+
+typedef void* (*LoadFunc)(struct Game *game, void (*progress)(struct Game*));
+typedef void (*StateFunc)(struct Game *game, void *data);
+typedef void (*EventFunc)(struct Game *game, void *data, ALLEGRO_EVENT *ev);
+
+struct Date {
+		LoadFunc load;
+		StateFunc unload, start, stop, logic, draw;
+		EventFunc process;
+		void *data;
+};
+
+static void Progress(struct Game *game) {}
+
+static void* Find(const struct StaticGamestate *gamestate, const char *symbol) {
+	void *ptr = FindStaticSymbol(gamestate, symbol);
+	if (!ptr) {
+		fprintf(stderr, "%s has no %s.\n", gamestate->name, symbol);
+	}
+	return ptr;
+}
+
+static void Send(struct Game *game, struct Date *date, ALLEGRO_EVENT *ev) {
+	// the same way the engine does it
+	if (!GlobalEventHandler(game, ev)) {
+		date->process(game, date->data, ev);
+	}
+}
+
+static void Key(struct Game *game, struct Date *date, int keycode) {
+	ALLEGRO_EVENT ev = { .type = ALLEGRO_EVENT_KEY_DOWN };
+	ev.keyboard.keycode = keycode;
+	Send(game, date, &ev);
+}
+
+static void Mouse(struct Game *game, struct Date *date, unsigned int type, int x, int y) {
+	ALLEGRO_EVENT ev = { .type = type };
+	ev.mouse.x = x;
+	ev.mouse.y = y;
+	ev.mouse.button = 1;
+	Send(game, date, &ev);
+}
+
+static void Play(struct Game *game, struct Date *date, int frame) {
+	// what a player would do, roughly: start, skip through the lines, scribble all over and sometimes cheat
+	int f = frame % ROUND_FRAMES;
+	if (f == 10) {
+		Key(game, date, ALLEGRO_KEY_SPACE);
+	}
+	if (f % 45 == 0) {
+		Key(game, date, ALLEGRO_KEY_FULLSTOP); // the voices never finish playing without a sound card
+	}
+	if (f % 300 == 0) {
+		Key(game, date, ALLEGRO_KEY_C);
+	}
+	if (f % 120 == 0) {
+		Mouse(game, date, ALLEGRO_EVENT_MOUSE_BUTTON_DOWN, game->viewport.width / 2, game->viewport.height / 2);
+	}
+	int x = game->viewport.width / 4 + (f % 40) * game->viewport.width / 80;
+	int y = game->viewport.height / 3 + ((f / 40) % 2 ? f % 40 : 40 - f % 40) * game->viewport.height / 120;
+	Mouse(game, date, ALLEGRO_EVENT_MOUSE_AXES, x, y);
+}
+
+int main(int argc, char** argv) {
+	int frames = (argc > 1) ? atoi(argv[1]) : DEFAULT_FRAMES;
+	if (frames <= 0) {
+		fprintf(stderr, "Usage: %s [frames]\n", argv[0]);
+		return 1;
+	}
+
+	const char *name = "date";
+	const struct StaticGamestate *gamestate = FindStaticGamestate(name, strlen(name));
+	if (!gamestate) {
+		fprintf(stderr, "The date isn't linked in.\n");
+		return 1;
+	}
+	struct Date date = {
+		.load = (LoadFunc)Find(gamestate, "Gamestate_Load"),
+		.unload = (StateFunc)Find(gamestate, "Gamestate_Unload"),
+		.start = (StateFunc)Find(gamestate, "Gamestate_Start"),
+		.stop = (StateFunc)Find(gamestate, "Gamestate_Stop"),
+		.logic = (StateFunc)Find(gamestate, "Gamestate_Logic"),
+		.draw = (StateFunc)Find(gamestate, "Gamestate_Draw"),
+		.process = (EventFunc)Find(gamestate, "Gamestate_ProcessEvent")
+	};
+	if (!date.load || !date.unload || !date.start || !date.stop || !date.logic || !date.draw || !date.process) {
+		return 1;
+	}
+
+	srand(0);
+	struct Game *game = CreateHeadlessGame(1280, 720);
+	if (!game) {
+		return 1;
+	}
+	ALLEGRO_BITMAP *frame = al_create_bitmap(game->viewport.width, game->viewport.height);
+	al_set_target_bitmap(frame);
+
+	double time = al_get_time();
+	date.data = date.load(game, Progress);
+	for (int i = 0; i < frames; i++) {
+		if (i % ROUND_FRAMES == 0) {
+			if (i) {
+				date.stop(game, date.data);
+			}
+			date.start(game, date.data);
+		}
+		ALLEGRO_EVENT tick = { .type = ALLEGRO_EVENT_TIMER };
+		Send(game, &date, &tick);
+		Play(game, &date, i);
+		date.logic(game, date.data);
+		al_set_target_bitmap(frame);
+		al_clear_to_color(al_map_rgb(0, 0, 0));
+		date.draw(game, date.data);
+	}
+	date.stop(game, date.data);
+	StopGameData(game, game->data);
+	date.unload(game, date.data);
+	al_destroy_bitmap(frame);
+	DestroyHeadlessGame(game);
+
+	printf("%d frames of the date in %.1f s\n", frames, al_get_time() - time);
+	return 0;
+}
@@ -0,0 +1,230 @@
+/*! \file cache.c
+ *  \brief Assets shared between gamestates.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "common.h"
+#include <libsuperderpy.h>
+
+struct Cache* CreateCache(size_t budget) {
+	struct Cache *cache = calloc(1, sizeof(struct Cache));
+	cache->budget = budget;
+	return cache;
+}
+
+static struct Cache* GetCache(struct Game *game) {
+	return game->data ? game->data->cache : NULL;
+}
+
+static void DestroyEntry(struct Game *game, struct CacheEntry *entry) {
+	switch (entry->kind) {
+		case CACHE_BITMAP:
+			DestroyTrackedBitmap(game, entry->ptr);
+			break;
+		case CACHE_FONT:
+			DestroyTrackedFont(game, entry->ptr);
+			break;
+		case CACHE_SAMPLE:
+			DestroyTrackedSample(game, entry->ptr);
+			break;
+	}
+	free(entry->name);
+	free(entry);
+}
+
+static struct CacheEntry* FindEntry(struct Cache *cache, enum CacheKind kind, const char *name, int param) {
+	for (struct CacheEntry *entry = cache->entries; entry; entry = entry->next) {
+		if ((entry->kind == kind) && (entry->param == param) && !strcmp(entry->name, name)) {
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+static void* Reference(struct Game *game, struct Cache *cache, const char *owner, struct CacheEntry *entry) {
+	if (!entry->refs) {
+		cache->idle -= entry->bytes;
+	}
+	entry->refs++;
+	ShareAsset(game, owner, entry->ptr);
+	return entry->ptr;
+}
+
+void* AcquireCached(struct Game *game, const char *owner, enum CacheKind kind, const char *name, int param) {
+	// Returns a new reference to an already loaded asset, or NULL if it has to be loaded and stored.
+	struct Cache *cache = GetCache(game);
+	if (!cache) {
+		return NULL;
+	}
+	struct CacheEntry *entry = FindEntry(cache, kind, name, param);
+	if (!entry) {
+		cache->misses++;
+		return NULL;
+	}
+	cache->hits++;
+	return Reference(game, cache, owner, entry);
+}
+
+void* StoreCached(struct Game *game, const char *owner, enum CacheKind kind, const char *name, int param, void *ptr) {
+	// Takes over an asset that has just been loaded, returning it with a single reference. Should the same one
+	// have been stored in the meantime (by a synchronous load while a loader job for it was on the way, say),
+	// that one is returned instead and the new copy destroyed, as only one of them could ever be hit.
+	struct Cache *cache = GetCache(game);
+	if (!cache || !ptr) {
+		return ptr;
+	}
+	struct CacheEntry *entry = FindEntry(cache, kind, name, param);
+	if (entry) {
+		switch (kind) {
+			case CACHE_BITMAP:
+				al_destroy_bitmap(ptr);
+				break;
+			case CACHE_FONT:
+				al_destroy_font(ptr);
+				break;
+			case CACHE_SAMPLE:
+				al_destroy_sample(ptr);
+				break;
+		}
+		return Reference(game, cache, owner, entry);
+	}
+	switch (kind) {
+		case CACHE_BITMAP:
+			TrackBitmap(game, "cache", name, ptr);
+			break;
+		case CACHE_FONT:
+			TrackFont(game, "cache", (char*)name, ptr);
+			break;
+		case CACHE_SAMPLE:
+			TrackSample(game, "cache", name, ptr);
+			break;
+	}
+	entry = calloc(1, sizeof(struct CacheEntry));
+	entry->kind = kind;
+	entry->name = strdup(name);
+	entry->param = param;
+	entry->ptr = ptr;
+	entry->refs = 1;
+	entry->bytes = GetAssetBytes(game, ptr);
+	entry->next = cache->entries;
+	cache->entries = entry;
+	ShareAsset(game, owner, ptr);
+	return ptr;
+}
+
+ALLEGRO_BITMAP* AcquireBitmap(struct Game *game, const char *owner, char *filename) {
+	// the same file loaded with other flags is a different bitmap
+	int flags = al_get_new_bitmap_flags();
+	ALLEGRO_BITMAP *bitmap = AcquireCached(game, owner, CACHE_BITMAP, filename, flags);
+	if (!bitmap) {
+		bitmap = StoreCached(game, owner, CACHE_BITMAP, filename, flags, al_load_bitmap(GetDataFilePath(game, filename)));
+	}
+	return bitmap;
+}
+
+ALLEGRO_FONT* AcquireFont(struct Game *game, const char *owner, char *filename, int size) {
+	ALLEGRO_FONT *font = AcquireCached(game, owner, CACHE_FONT, filename, size);
+	if (!font) {
+		font = StoreCached(game, owner, CACHE_FONT, filename, size, al_load_font(GetDataFilePath(game, filename), size, 0));
+	}
+	return font;
+}
+
+ALLEGRO_SAMPLE* AcquireSample(struct Game *game, const char *owner, char *filename) {
+	ALLEGRO_SAMPLE *sample = AcquireCached(game, owner, CACHE_SAMPLE, filename, 0);
+	if (!sample) {
+		sample = StoreCached(game, owner, CACHE_SAMPLE, filename, 0, al_load_sample(GetDataFilePath(game, filename)));
+	}
+	return sample;
+}
+
+void ReleaseCached(struct Game *game, const char *owner, void *ptr) {
+	struct Cache *cache = GetCache(game);
+	if (!cache || !ptr) {
+		return;
+	}
+	for (struct CacheEntry *entry = cache->entries; entry; entry = entry->next) {
+		if (entry->ptr == ptr) {
+			UnshareAsset(game, owner, ptr);
+			if (--entry->refs == 0) {
+				entry->used = ++cache->clock;
+				cache->idle += entry->bytes;
+				TrimCache(game, cache->budget);
+			}
+			return;
+		}
+	}
+	PrintConsole(game, "ERROR: Releasing %p, which isn't in the cache!", ptr);
+}
+
+void TrimCache(struct Game *game, size_t budget) {
+	// Evicts the least recently released entries until the unreferenced ones fit in the budget.
+	struct Cache *cache = GetCache(game);
+	if (!cache) {
+		return;
+	}
+	while (cache->idle > budget) {
+		struct CacheEntry **oldest = NULL;
+		for (struct CacheEntry **tmp = &cache->entries; *tmp; tmp = &(*tmp)->next) {
+			if (!(*tmp)->refs && (!oldest || ((*tmp)->used < (*oldest)->used))) {
+				oldest = tmp;
+			}
+		}
+		if (!oldest) {
+			break;
+		}
+		struct CacheEntry *entry = *oldest;
+		*oldest = entry->next;
+		cache->idle -= entry->bytes;
+		cache->evictions++;
+		DestroyEntry(game, entry);
+	}
+	// zero-sized entries don't count towards the budget, so they only go when everything does
+	if (!budget) {
+		for (struct CacheEntry **tmp = &cache->entries; *tmp;) {
+			struct CacheEntry *entry = *tmp;
+			if (entry->refs) {
+				tmp = &entry->next;
+				continue;
+			}
+			*tmp = entry->next;
+			cache->evictions++;
+			DestroyEntry(game, entry);
+		}
+	}
+}
+
+void StopCache(struct Game *game, struct Cache *cache) {
+	// From now on everything goes away on its last release, while Allegro is still around to destroy it.
+	PrintConsole(game, "Cache: %d hits, %d misses, %d evictions", cache->hits, cache->misses, cache->evictions);
+	cache->budget = 0;
+	TrimCache(game, 0);
+}
+
+void DestroyCache(struct Cache *cache) {
+	while (cache->entries) {
+		struct CacheEntry *entry = cache->entries;
+		cache->entries = entry->next;
+		fprintf(stderr, "LEAK: %s (%d) still has %d references in the cache on exit!\n", entry->name, entry->param, entry->refs);
+		free(entry->name);
+		free(entry);
+	}
+	free(cache);
+}
@@ -0,0 +1,75 @@
+/*! \file cache.h
+ *  \brief Assets shared between gamestates.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLINDDATE_CACHE_H
+#define BLINDDATE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <allegro5/allegro.h>
+#include <allegro5/allegro_font.h>
+#include <allegro5/allegro_audio.h>
+
+struct Game;
+
+enum CacheKind {
+	CACHE_BITMAP,
+	CACHE_FONT,
+	CACHE_SAMPLE
+};
+
+/*! \brief Loaded asset along with what it was loaded from. */
+struct CacheEntry {
+		enum CacheKind kind;
+		char *name; /*!< Data file path, or a description of how it was generated. */
+		int param; /*!< Font size, bitmap flags and such; part of the key along with the name. */
+		void *ptr;
+		int refs;
+		size_t bytes;
+		unsigned long used; /*!< When it was last released, for picking what to evict. */
+		struct CacheEntry *next;
+};
+
+/*! \brief Refcounted assets, kept around after their last release until they don't fit in the budget.
+ *
+ * Everything in it is registered with the registry under the "cache" owner,
+ * and shared with every gamestate for as long as it holds a reference, so it's
+ * counted in their totals and reported as their leak if never released. Only
+ * to be used from the display thread. */
+struct Cache {
+		struct CacheEntry *entries;
+		size_t budget; /*!< How many bytes of unreferenced entries may be kept. */
+		size_t idle; /*!< Bytes held by unreferenced entries. */
+		unsigned long clock;
+		int hits, misses, evictions;
+};
+
+struct Cache* CreateCache(size_t budget);
+void* AcquireCached(struct Game *game, const char *owner, enum CacheKind kind, const char *name, int param);
+void* StoreCached(struct Game *game, const char *owner, enum CacheKind kind, const char *name, int param, void *ptr);
+ALLEGRO_BITMAP* AcquireBitmap(struct Game *game, const char *owner, char *filename);
+ALLEGRO_FONT* AcquireFont(struct Game *game, const char *owner, char *filename, int size);
+ALLEGRO_SAMPLE* AcquireSample(struct Game *game, const char *owner, char *filename);
+void ReleaseCached(struct Game *game, const char *owner, void *ptr);
+void TrimCache(struct Game *game, size_t budget);
+void StopCache(struct Game *game, struct Cache *cache);
+void DestroyCache(struct Cache *cache);
+
+#endif
@@ -18,10 +18,25 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "defines.h"
 #include "common.h"
 #include <libsuperderpy.h>
+#include <math.h>
+
+#define CACHE_BUDGET 32 // MiB of assets no gamestate uses at the moment, kept for the next one that wants them
+#define LIGHT_WIDTH (320*2) // light maps at the high quality, as big as the canvas
+#define LIGHT_HEIGHT (180*2)
 
 bool GlobalEventHandler(struct Game *game, ALLEGRO_EVENT *ev) {
+	LATENCY_SHOWN(al_get_time()); // the last frame has been flipped by the time any event gets here, if that wasn't caught
+
+	if (ev->type == ALLEGRO_EVENT_TIMER) {
+		// before the gamestates get their logic tick, so they never see a job half-completed
+		RunJobCompletions(game, game->data->jobs);
+		// and whatever changed the viewport (a resize handled by libsuperderpy, say), they hear of it by then too
+		CheckViewport(game);
+	}
+
 	if ((ev->type==ALLEGRO_EVENT_KEY_DOWN) && (ev->keyboard.keycode == ALLEGRO_KEY_F)) {
 		game->config.fullscreen = !game->config.fullscreen;
 		if (game->config.fullscreen) {
@@ -33,18 +48,186 @@ bool GlobalEventHandler(struct Game *game, ALLEGRO_EVENT *ev) {
 		}
 		al_set_display_flag(game->display, ALLEGRO_FULLSCREEN_WINDOW, game->config.fullscreen);
 		SetupViewport(game, game->viewport_config);
+		CheckViewport(game);
 		PrintConsole(game, "Fullscreen toggled");
 	}
 
 	return false;
 }
 
+void AddViewportListener(struct Game *game, void (*changed)(struct Game*, void*, int, int, int, int), void *data) {
+	struct ViewportListener *listener = calloc(1, sizeof(struct ViewportListener));
+	listener->changed = changed;
+	listener->data = data;
+	listener->next = game->data->viewport_listeners;
+	game->data->viewport_listeners = listener;
+}
+
+void RemoveViewportListener(struct Game *game, void (*changed)(struct Game*, void*, int, int, int, int), void *data) {
+	struct ViewportListener **tmp = &game->data->viewport_listeners;
+	while (*tmp) {
+		if (((*tmp)->changed == changed) && ((*tmp)->data == data)) {
+			struct ViewportListener *listener = *tmp;
+			*tmp = listener->next;
+			free(listener);
+			return;
+		}
+		tmp = &(*tmp)->next;
+	}
+}
+
+void CheckViewport(struct Game *game) {
+	// Tells the listeners when the viewport size differs from the last time, with both the old and the new one,
+	// so each can rebuild just what depends on it. Cheap enough to be called on every tick.
+	struct CommonResources *data = game->data;
+	int old_width = data->viewport_width, old_height = data->viewport_height;
+	if ((game->viewport.width == old_width) && (game->viewport.height == old_height)) {
+		return;
+	}
+	data->viewport_width = game->viewport.width;
+	data->viewport_height = game->viewport.height;
+	PrintConsole(game, "Viewport changed from %dx%d to %dx%d", old_width, old_height, data->viewport_width, data->viewport_height);
+	for (struct ViewportListener *listener = data->viewport_listeners; listener; listener = listener->next) {
+		listener->changed(game, listener->data, old_width, old_height, data->viewport_width, data->viewport_height);
+	}
+}
+
+ALLEGRO_BITMAP* CreateScaledBitmap(ALLEGRO_BITMAP *source, int width, int height) {
+	// Halves the bitmap until it's less than twice the wanted size before the final scaling, so with linear
+	// filtering every source pixel ends up averaged in instead of most of them being skipped.
+	ALLEGRO_STATE state;
+	al_store_state(&state, ALLEGRO_STATE_TARGET_BITMAP | ALLEGRO_STATE_NEW_BITMAP_PARAMETERS | ALLEGRO_STATE_BLENDER);
+	al_set_new_bitmap_flags(ALLEGRO_MIN_LINEAR | ALLEGRO_MAG_LINEAR);
+	al_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_ZERO);
+
+	ALLEGRO_BITMAP *bitmap = source;
+	int w = al_get_bitmap_width(source), h = al_get_bitmap_height(source);
+	while ((w >= width * 2) && (h >= height * 2)) {
+		ALLEGRO_BITMAP *half = al_create_bitmap(w / 2, h / 2);
+		al_set_target_bitmap(half);
+		al_draw_scaled_bitmap(bitmap, 0, 0, w, h, 0, 0, w / 2, h / 2, 0);
+		if (bitmap != source) {
+			al_destroy_bitmap(bitmap);
+		}
+		bitmap = half;
+		w /= 2;
+		h /= 2;
+	}
+
+	ALLEGRO_BITMAP *result = al_create_bitmap(width, height);
+	al_set_target_bitmap(result);
+	al_draw_scaled_bitmap(bitmap, 0, 0, w, h, 0, 0, width, height, 0);
+	if (bitmap != source) {
+		al_destroy_bitmap(bitmap);
+	}
+	al_restore_state(&state);
+	return result;
+}
+
+ALLEGRO_BITMAP* PrescaleToViewport(struct Game *game, const char *owner, const char *name, ALLEGRO_BITMAP *cache, ALLEGRO_BITMAP *source) {
+	// Returns the cache if it still matches the viewport, otherwise replaces it with a freshly scaled copy of source.
+	if (cache && (al_get_bitmap_width(cache) == game->viewport.width) && (al_get_bitmap_height(cache) == game->viewport.height)) {
+		return cache;
+	}
+	if (cache) {
+		DestroyTrackedBitmap(game, cache);
+	}
+	return TrackBitmap(game, owner, name, CreateScaledBitmap(source, game->viewport.width, game->viewport.height));
+}
+
+void GenerateLight(ALLEGRO_BITMAP *bitmap, int maxr) {
+	// maxr is in LIGHT_WIDTH pixels, whatever the size of the bitmap
+	int width = al_get_bitmap_width(bitmap);
+	int height = al_get_bitmap_height(bitmap);
+	float scale = LIGHT_WIDTH / (float)width;
+	ALLEGRO_LOCKED_REGION *region = al_lock_bitmap(bitmap, ALLEGRO_PIXEL_FORMAT_RGBA_8888, ALLEGRO_LOCK_WRITEONLY);
+	unsigned char *d = region->data;
+	for (int x = 0; x < width; x++) {
+		for (int y = 0; y < height; y++) {
+			float r = sqrt(pow(x*scale-325, 2) + pow(y*scale-256, 2));
+			for (int z = 0; z < region->pixel_size; z++) {
+				d[x * region->pixel_size + region->pitch * y + z] = fmin(255, fmax(0, maxr - r) * (256 / (float)maxr) * 4);
+				if (!r) {
+					d[x * region->pixel_size + region->pitch * y + z] = 255;
+				}
+			}
+		}
+	}
+	al_unlock_bitmap(bitmap);
+}
+
+void GenerateLightWork(struct LoaderJob *job) {
+	ALLEGRO_BITMAP *bitmap = al_create_bitmap(LIGHT_WIDTH / job->quality->light_scale, LIGHT_HEIGHT / job->quality->light_scale);
+	GenerateLight(bitmap, job->param);
+	job->result = bitmap;
+}
+
+void LoadSpriteWork(struct LoaderJob *job) {
+	// drawn scaled back up by sprite_scale, see Gamestate_Draw of the date
+	ALLEGRO_BITMAP *bitmap = al_load_bitmap(job->path);
+	int scale = job->quality->sprite_scale;
+	if (bitmap && (scale > 1)) {
+		job->result = CreateScaledBitmap(bitmap, al_get_bitmap_width(bitmap) / scale, al_get_bitmap_height(bitmap) / scale);
+		al_destroy_bitmap(bitmap);
+		return;
+	}
+	job->result = bitmap;
+}
+
+void PreloadDate(struct Game *game) {
+	// Starts decoding the date's DATE_ASSETS while the splash screens are playing; its Gamestate_Load claims them.
+	TRACE_INSTANT("PreloadDate");
+	struct Loader *loader = game->data->loader;
+#define PRELOAD_SPRITESHEET(character, name, field) \
+	PreloadLoaderJob(loader, LoadSpriteWork, GetDataFilePath(game, "sprites/" character "/" name ".png"), 0);
+#define PRELOAD_LIGHT(maxr, field) PreloadLoaderJob(loader, GenerateLightWork, NULL, maxr);
+#define PRELOAD_BITMAP(filename, field) PreloadLoaderJob(loader, LoadMemoryBitmapWork, GetDataFilePath(game, filename), 0);
+#define PRELOAD_STREAM(filename, field) PreloadLoaderJob(loader, LoadAudioStreamWork, GetDataFilePath(game, filename), 0);
+	DATE_ASSETS(PRELOAD_SPRITESHEET, PRELOAD_LIGHT, PRELOAD_BITMAP, PRELOAD_STREAM)
+	// and the first symbol, which is needed right away; the date's resident for it claims this one
+	PreloadLoaderJob(loader, LoadMemoryBitmapWork, GetDataFilePath(game, "symbols/n.png"), 0);
+}
+
+bool IsDatePreloaded(struct Game *game) {
+	// Until this is true, switching to the date would make its Gamestate_Load wait for the decoding.
+	return !IsLoaderBusy(game->data->loader);
+}
+
 struct CommonResources* CreateGameData(struct Game *game) {
 	struct CommonResources *data = calloc(1, sizeof(struct CommonResources));
+	int threads = al_get_cpu_count() - 1;
+	data->jobs = CreateJobs((threads < 1) ? 1 : ((threads > 4) ? 4 : threads));
+	LoadQuality(game, &data->quality);
+	data->loader = CreateLoader(data->jobs, &data->quality);
+	data->registry = CreateRegistry(game->config.debug);
+	char *budget = GetConfigOption(game, "BlindDate", "cache_budget"); // in MiB
+	data->cache = CreateCache((budget ? atoi(budget) : CACHE_BUDGET) * 1024 * 1024);
+	free(budget);
+	data->viewport_width = game->viewport.width;
+	data->viewport_height = game->viewport.height;
 	return data;
 }
 
-void DestroyGameData(struct Game *game, struct CommonResources *data) {
+void StopGameData(struct Game *game, struct CommonResources *data) {
+	// Called before libsuperderpy_destroy, which shuts Allegro down after unloading the gamestates.
+	StopLoader(data->loader);
+	FinishJobs(game, data->jobs);
+	StopJobs(data->jobs);
+	StopCache(game, data->cache);
+}
+
+void DestroyGameData(struct CommonResources *data) {
+	// Called after libsuperderpy_destroy, as the gamestates still use the common data in their Gamestate_Unload.
+	DestroyLoader(data->loader);
+	DestroyJobs(data->jobs);
+	DestroyCache(data->cache);
+	while (data->viewport_listeners) {
+		// left by a gamestate that never got unloaded
+		struct ViewportListener *listener = data->viewport_listeners;
+		data->viewport_listeners = listener->next;
+		free(listener);
+	}
+	DestroyRegistry(data->registry, LIBSUPERDERPY_GAMENAME "-assets.txt");
 	free(data);
 }
 
@@ -17,11 +17,69 @@
 
 #define LIBSUPERDERPY_DATA_TYPE struct CommonResources
 #include <libsuperderpy.h>
+#include "cache.h"
+#include "jobs.h"
+#include "latency.h"
+#include "loader.h"
+#include "pool.h"
+#include "quality.h"
+#include "registry.h"
+#include "trace.h"
+
+/*! \brief Gamestate's callback for when the viewport changes size, see CheckViewport. */
+struct ViewportListener {
+		void (*changed)(struct Game *game, void *data, int old_width, int old_height, int width, int height);
+		void *data;
+		struct ViewportListener *next;
+};
 
 struct CommonResources {
 		// Fill in with common data accessible from all gamestates.
+		struct Jobs *jobs;
+		struct Loader *loader;
+		struct Registry *registry;
+		struct Cache *cache;
+		struct Quality quality;
+		struct ViewportListener *viewport_listeners;
+		int viewport_width, viewport_height; // as the listeners were last told
 };
 
 struct CommonResources* CreateGameData(struct Game *game);
-void DestroyGameData(struct Game *game, struct CommonResources *data);
+void StopGameData(struct Game *game, struct CommonResources *data);
+void DestroyGameData(struct CommonResources *data);
 bool GlobalEventHandler(struct Game *game, ALLEGRO_EVENT *ev);
+void AddViewportListener(struct Game *game, void (*changed)(struct Game*, void*, int, int, int, int), void *data);
+void RemoveViewportListener(struct Game *game, void (*changed)(struct Game*, void*, int, int, int, int), void *data);
+void CheckViewport(struct Game *game);
+void GenerateLight(ALLEGRO_BITMAP *bitmap, int maxr);
+ALLEGRO_BITMAP* CreateScaledBitmap(ALLEGRO_BITMAP *source, int width, int height);
+ALLEGRO_BITMAP* PrescaleToViewport(struct Game *game, const char *owner, const char *name, ALLEGRO_BITMAP *cache, ALLEGRO_BITMAP *source);
+void GenerateLightWork(struct LoaderJob *job);
+void LoadSpriteWork(struct LoaderJob *job);
+
+/*! \brief Assets the date gamestate queues on the loader in its Gamestate_Load, biggest first.
+ *
+ * Expanded by PreloadDate, which starts decoding them during the splash
+ * screens, and by the date's Gamestate_Load, which claims those jobs, so the
+ * two can't go out of sync. The last argument of each is the field of the
+ * date's resources it ends up in. Residents (the symbols, the happy warthog
+ * and the ending music) aren't here, as they're streamed in by the stage. */
+#define DATE_ASSETS(SPRITESHEET, LIGHT, BITMAP, STREAM) \
+	SPRITESHEET("warthog", "1", warthog) \
+	SPRITESHEET("warthog", "2", warthog) \
+	SPRITESHEET("warthog", "3", warthog) \
+	SPRITESHEET("table", "1", table) \
+	SPRITESHEET("table", "2", table) \
+	SPRITESHEET("table", "3", table) \
+	SPRITESHEET("fire", "fire", fire) \
+	LIGHT(32, light1) \
+	LIGHT(64, light2) \
+	LIGHT(128, light3) \
+	BITMAP("bg.png", bg) \
+	BITMAP("point.png", pointer) \
+	BITMAP("draw.png", pencil) \
+	BITMAP("heart.png", heart) \
+	STREAM("bg.ogg", bgnoise)
+
+void PreloadDate(struct Game *game);
+bool IsDatePreloaded(struct Game *game);
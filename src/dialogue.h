@@ -0,0 +1,102 @@
+/*! \file dialogue.h
+ *  \brief Binary dialogue table format, shared by dialoguec and the date gamestate.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLINDDATE_DIALOGUE_H
+#define BLINDDATE_DIALOGUE_H
+
+#include <stdint.h>
+
+/* All values are little-endian. The file is laid out as:
+ *
+ *   header          DIALOGUE_HEADER_SIZE bytes
+ *   stages          stage_count * DIALOGUE_STAGE_SIZE bytes (stage 1 first)
+ *   ops             op_count * DIALOGUE_OP_SIZE bytes
+ *   strings         string_bytes bytes of NUL-terminated strings
+ *
+ * header: char magic[4], u16 version, u16 stage_count, u16 op_count,
+ *         u16 string_count, u32 string_bytes
+ * stage:  u16 score1, u16 score2 (thresholds in 1/1000), u16 node[DIALOGUE_NODE_COUNT]
+ * op:     u8 opcode, u8 arg, u16 a, u16 b
+ *
+ * Nodes are entry points into the op array and run until DIALOGUE_OP_RETURN.
+ * Strings are referenced by their index in the string block. */
+
+#define DIALOGUE_MAGIC "BDLG"
+#define DIALOGUE_VERSION 1
+
+#define DIALOGUE_HEADER_SIZE 16
+#define DIALOGUE_STAGE_SIZE (4 + 2 * DIALOGUE_NODE_COUNT)
+#define DIALOGUE_OP_SIZE 6
+
+#define DIALOGUE_NONE 0xFFFF
+
+enum DialogueNode {
+	DIALOGUE_NODE_INTRO,
+	DIALOGUE_NODE_WON,
+	DIALOGUE_NODE_LOST,
+	DIALOGUE_NODE_COUNT
+};
+
+enum DialogueOpcode {
+	DIALOGUE_OP_RETURN,
+	DIALOGUE_OP_SAY,         /* arg: speaker, a: voice string, b: text string or DIALOGUE_NONE */
+	DIALOGUE_OP_JUMP,        /* a: target op */
+	DIALOGUE_OP_JUMP_IF,     /* arg: fact, a: target op */
+	DIALOGUE_OP_JUMP_UNLESS, /* arg: fact, a: target op */
+	DIALOGUE_OP_SET,         /* arg: fact */
+	DIALOGUE_OP_DRAW,        /* arg: symbol */
+	DIALOGUE_OP_STAGE,       /* arg: signed stage delta, applied right away */
+	DIALOGUE_OP_NEXTSTAGE,   /* queues a stage increment on the timeline */
+	DIALOGUE_OP_DECIDE,      /* queues the intro of the then-current stage */
+	DIALOGUE_OP_END,         /* queues the ending */
+	DIALOGUE_OP_COUNT
+};
+
+enum DialogueSpeaker {
+	DIALOGUE_SPEAKER_GREG,
+	DIALOGUE_SPEAKER_PLAYER,
+	DIALOGUE_SPEAKER_COUNT
+};
+
+enum DialogueFact {
+	DIALOGUE_FACT_NAME,
+	DIALOGUE_FACT_WEAKNESS,
+	DIALOGUE_FACT_BITTEN,
+	DIALOGUE_FACT_CROCODILE,
+	DIALOGUE_FACT_COUNT
+};
+
+enum DialogueSymbol {
+	DIALOGUE_SYMBOL_N,
+	DIALOGUE_SYMBOL_HEART,
+	DIALOGUE_SYMBOL_BERRY,
+	DIALOGUE_SYMBOL_WARTHOG,
+	DIALOGUE_SYMBOL_COUNT
+};
+
+static inline uint16_t DialogueReadU16(const unsigned char *p) {
+	return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t DialogueReadU32(const unsigned char *p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+#endif
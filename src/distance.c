@@ -0,0 +1,145 @@
+/*! \file distance.c
+ *  \brief Signed distance fields of coverage masks.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "distance.h"
+
+#define INF 1e20f
+
+static void Transform1D(float *f, int n, int stride, float *d, int *v, float *z) {
+	// Felzenszwalb & Huttenlocher: lower envelope of the parabolas rooted at every sample, in linear time.
+	int k = 0;
+	v[0] = 0;
+	z[0] = -INF;
+	z[1] = INF;
+	for (int q = 1; q < n; q++) {
+		float s = ((f[q * stride] + q * q) - (f[v[k] * stride] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+		while (s <= z[k]) {
+			k--;
+			s = ((f[q * stride] + q * q) - (f[v[k] * stride] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+		}
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = INF;
+	}
+	k = 0;
+	for (int q = 0; q < n; q++) {
+		while (z[k + 1] < q) {
+			k++;
+		}
+		d[q] = (q - v[k]) * (q - v[k]) + f[v[k] * stride];
+	}
+	for (int q = 0; q < n; q++) {
+		f[q * stride] = d[q];
+	}
+}
+
+static void Transform2D(float *f, int width, int height) {
+	// squared euclidean distance to the nearest zero, columns first and then rows
+	int n = (width > height) ? width : height;
+	float *d = malloc(n * sizeof(float));
+	int *v = malloc(n * sizeof(int));
+	float *z = malloc((n + 1) * sizeof(float));
+	for (int x = 0; x < width; x++) {
+		Transform1D(f + x, height, width, d, v, z);
+	}
+	for (int y = 0; y < height; y++) {
+		Transform1D(f + y * width, width, 1, d, v, z);
+	}
+	free(d);
+	free(v);
+	free(z);
+}
+
+struct DistanceField* CreateDistanceField(const unsigned char *mask, int width, int height, int pitch, int pixel_size, int scale) {
+	struct DistanceField *field = malloc(sizeof(struct DistanceField));
+	field->scale = scale;
+	field->width = width / scale;
+	field->height = height / scale;
+	int size = field->width * field->height;
+	field->d = malloc(size * sizeof(float));
+	float *inside = malloc(size * sizeof(float));
+
+	for (int y = 0; y < field->height; y++) {
+		for (int x = 0; x < field->width; x++) {
+			// sampled at the center of each scale x scale block
+			bool in = mask[(y * scale + scale / 2) * pitch + (x * scale + scale / 2) * pixel_size] >= 128;
+			field->d[y * field->width + x] = in ? 0 : INF;
+			inside[y * field->width + x] = in ? INF : 0;
+		}
+	}
+	Transform2D(field->d, field->width, field->height);
+	Transform2D(inside, field->width, field->height);
+	for (int i = 0; i < size; i++) {
+		// distance to the inside minus distance to the outside; at most one of them is non-zero
+		field->d[i] = (sqrtf(field->d[i]) - sqrtf(inside[i])) * scale;
+	}
+	free(inside);
+
+	// every other cell of the inside, so the symbol can be checked without going through the whole field
+	field->sample_count = 0;
+	field->samples = malloc((size / 4 + field->width + field->height + 1) * 2 * sizeof(float));
+	for (int y = 0; y < field->height; y += 2) {
+		for (int x = 0; x < field->width; x += 2) {
+			if (field->d[y * field->width + x] <= 0) {
+				field->samples[field->sample_count * 2] = (x + 0.5) * scale;
+				field->samples[field->sample_count * 2 + 1] = (y + 0.5) * scale;
+				field->sample_count++;
+			}
+		}
+	}
+	return field;
+}
+
+float SampleDistanceField(struct DistanceField *field, float x, float y) {
+	// bilinear, clamped to the edges
+	float fx = x / field->scale - 0.5, fy = y / field->scale - 0.5;
+	fx = fminf(fmaxf(fx, 0), field->width - 1);
+	fy = fminf(fmaxf(fy, 0), field->height - 1);
+	int x0 = fx, y0 = fy;
+	int x1 = (x0 + 1 < field->width) ? x0 + 1 : x0;
+	int y1 = (y0 + 1 < field->height) ? y0 + 1 : y0;
+	float tx = fx - x0, ty = fy - y0;
+	float *d = field->d;
+	float top = d[y0 * field->width + x0] * (1 - tx) + d[y0 * field->width + x1] * tx;
+	float bottom = d[y1 * field->width + x0] * (1 - tx) + d[y1 * field->width + x1] * tx;
+	return top * (1 - ty) + bottom * ty;
+}
+
+float DistanceToSegment(float x, float y, float x1, float y1, float x2, float y2) {
+	float dx = x2 - x1, dy = y2 - y1;
+	float len = dx * dx + dy * dy;
+	float t = len ? ((x - x1) * dx + (y - y1) * dy) / len : 0;
+	t = fminf(fmaxf(t, 0), 1);
+	return hypotf(x - (x1 + t * dx), y - (y1 + t * dy));
+}
+
+void DestroyDistanceField(struct DistanceField *field) {
+	if (!field) {
+		return;
+	}
+	free(field->samples);
+	free(field->d);
+	free(field);
+}
@@ -0,0 +1,41 @@
+/*! \file distance.h
+ *  \brief Signed distance fields of coverage masks.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BLINDDATE_DISTANCE_H
+#define BLINDDATE_DISTANCE_H
+
+/*! \brief Signed distance to the edge of a mask, negative inside of it.
+ *
+ * It's computed at 1/scale of the mask resolution, but both the coordinates
+ * and the distances are in mask pixels. */
+struct DistanceField {
+		int width, height, scale;
+		float *d;
+		float *samples; /*!< x, y pairs evenly spread over the inside, for coverage checks. */
+		int sample_count;
+};
+
+struct DistanceField* CreateDistanceField(const unsigned char *mask, int width, int height, int pitch, int pixel_size, int scale);
+float SampleDistanceField(struct DistanceField *field, float x, float y);
+float DistanceToSegment(float x, float y, float x1, float y1, float x2, float y2);
+void DestroyDistanceField(struct DistanceField *field);
+
+#endif
@@ -19,23 +19,115 @@
  */
 
 #include "../common.h"
+#include "../dialogue.h"
+#include "../distance.h"
+#include "../loader.h"
+#include <assert.h>
 #include <math.h>
 #include <libsuperderpy.h>
 
+struct DialogueStage {
+		float score1, score2; // drawing thresholds
+		int node[DIALOGUE_NODE_COUNT];
+};
+
+struct DialogueOp {
+		unsigned char opcode, arg;
+		uint16_t a, b;
+};
+
+struct Dialogue {
+		struct DialogueStage *stages;
+		int stage_count;
+		struct DialogueOp *ops;
+		int op_count;
+		char *blob;
+		char **strings;
+		char **voices; // data paths resolved at load time, NULL for strings that aren't voice files
+		int string_count;
+};
+
+enum LoadTargetType {
+	LOAD_TARGET_BITMAP,
+	LOAD_TARGET_STREAM,
+	LOAD_TARGET_SPRITESHEET,
+	LOAD_TARGET_FONT
+};
+
+struct LoadTarget {
+		enum LoadTargetType type;
+		void *ptr;
+		bool loading; // a loader job for it hasn't been finished yet
+		int format; // ALLEGRO_PIXEL_FORMAT_SINGLE_CHANNEL_8 for coverage bitmaps, otherwise left to Allegro
+		struct DistanceField **field; // if set, a distance field of the bitmap's alpha is made there as well
+		char *cache_name; // if set, the bitmap goes to the shared cache under this name and cache_param
+		int cache_param; // for fonts, the size that's wanted, which may be newer than the one being loaded
+		void *warming; // for fonts, the one that replaces ptr once WarmFont has rendered all its glyphs
+		int warmed; // how many of them so far
+};
+
+// Asset that is only needed in some stages. It gets streamed in one stage ahead and evicted one stage
+// after, since losing a drawing sends the player a stage back.
+struct Resident {
+		struct LoadTarget target;
+		char *path;
+		int from, to; // stages in which it's used; never if from > to
+};
+
+#define PREDICT_SAMPLES 3 // enough for the velocity and the acceleration
+#define PREDICT_LEAD (1/60.0) // seconds the shown frame is behind, on top of the wait for the next touch event
+#define PREDICT_HORIZON 0.05 // never further ahead than this, and nothing when the finger seems to have stopped
+#define PREDICT_DISTANCE 24.0 // in canvas pixels, so a jittery sample can't fling the extension across the screen
+
+/*! \brief Recent touch positions the stroke is extrapolated from, see PredictStroke. */
+struct StrokePrediction {
+		struct {
+				float x, y; // in canvas pixels
+				double time;
+		} samples[PREDICT_SAMPLES]; // oldest first
+		int count;
+};
+
+enum {
+	RESIDENT_HAPPY = DIALOGUE_SYMBOL_COUNT, // the first ones are the symbols, in DialogueSymbol order
+	RESIDENT_CARELESS,
+	RESIDENT_COUNT
+};
+
+/*! \brief How close the stroke got to every other cell of a distance field, the ones its samples are taken from. */
+struct StrokeCoverage {
+		float *nearest;
+		int width, height, size; // size is how many are allocated
+		float sum; // coverage of the cells inside of the symbol, so far
+};
+
 struct GamestateResources {
 		// This struct is for every resource allocated and used by your gamestate.
 		// It gets created on load and then gets passed around to all other function calls.
 		ALLEGRO_FONT *font, *smallfont;
+		struct LoadTarget font_target, smallfont_target; // sized to the viewport, reloaded in the background
+		int *glyphs; // every character the date can show, rendered by each new font before it gets used
+		int glyph_count;
+		ALLEGRO_BITMAP *glyph_target; // the glyphs are drawn there just to get them rendered
 		unsigned int blink_counter;
 		ALLEGRO_BITMAP *canvas;
 		ALLEGRO_BITMAP *drawbmp;
+
+		// The canvas and the symbols only carry coverage, so where the driver can render to them they're
+		// kept in a single channel and drawn through a shader that spreads it back into white with alpha.
+		ALLEGRO_SHADER *coverage;
+		int coverage_format;
 		ALLEGRO_BITMAP *pointer, *pencil;
 
-		ALLEGRO_BITMAP *sn, *sheart, *sberry, *swarthog;
+		ALLEGRO_BITMAP *symbols[DIALOGUE_SYMBOL_COUNT];
+		struct DistanceField *fields[DIALOGUE_SYMBOL_COUNT];
 
 		ALLEGRO_AUDIO_STREAM *bgnoise, *careless;
 
+		struct Resident residents[RESIDENT_COUNT];
+
 		ALLEGRO_BITMAP *light1, *light2, *light3, *light4, *tmp, *bg;
+		ALLEGRO_BITMAP *scaledbg; // bg at the viewport size
 		struct Character *warthog, *table, *fire;
 		bool button;
 		int x, y;
@@ -47,20 +139,44 @@ struct GamestateResources {
 		int timeleft, time;
 		bool cheat;
 
-		struct {
-				bool name;
-				bool weakness;
-				bool bitten;
-				bool crocodile;
-		} facts;
+		bool facts[DIALOGUE_FACT_COUNT];
 
 		bool skip;
 		char* text;
 		bool player;
 
 		struct Timeline *timeline;
-
-		float score1, score2;
+		struct Dialogue *dialogue;
+		struct Pool *cues;
+
+		float score1, score2; // raster overlap, which the thresholds in the dialogue are tuned for
+		float distance1, distance2; // the same, but from the stroke segments against the symbol's distance field
+		bool distance_scoring; // decide by the distance score; it's more forgiving near the edges, so only when asked for
+		struct StrokeCoverage stroke_coverage;
+
+		struct StrokeSegment *stroke;
+		int stroke_count;
+		struct DistanceField *drawfield;
+		struct StrokePrediction prediction; // drawn ahead of the finger on touch, over the canvas and never onto it
+		bool scoring, scored; // CalculateDistanceScore has been submitted to the shared jobs, and has completed
+		double score_time;
+
+		// live estimate of the scores that decide the round: a coarse raster of the canvas filled in as segments come,
+		// or with scoring=distance, the distance score worked out a segment at a time
+		unsigned char *meter_grid;
+		int meter_width, meter_height;
+		int meter_segments; // how many of the stroke segments have been put into the grid so far
+		int meter_inside, meter_drawn, meter_hits; // cells of the symbol, cells drawn on and cells that are both
+		float meter_sum, meter_total; // accuracy of the distance score, as in CalculateDistanceScore
+		struct StrokeCoverage meter_coverage;
+		double meter_time, meter_peak; // per-frame cost of the meter in this round
+		int meter_frames;
+
+		// submissions and state changes made by Gamestate_Draw, to see what batching buys; see CountDraw
+		int draw_calls, state_changes;
+		bool holding; // bitmap drawing is held
+		int held; // draws waiting for it to be released
+		int stats_frames, stats_draw_calls, stats_state_changes;
 
 		bool end;
 
@@ -68,35 +184,475 @@ struct GamestateResources {
 		ALLEGRO_BITMAP *heart;
 
 		bool touch;
+
+		double load_start;
+		bool interactive;
+
+		// soak testing without a player, see Autoplay
+		bool autoplay;
+		int autoplay_speed; // logic steps per frame
+		uint32_t autoplay_rng;
+		bool autoplay_pass; // whether the drawing in progress is meant to pass
+		int autoplay_sample; // next sample of the symbol to stroke over
+		int autoplay_ticks; // since the end was reached
+		int autoplay_runs, autoplay_passed, autoplay_failed, autoplay_mismatches;
+		int actions; // queued on the timeline and not destroyed yet
 };
 
-bool Speak(struct Game *game, struct TM_Action *action, enum TM_ActionState state) {
-	struct GamestateResources *data = TM_GetArg(action->arguments, 0);
-	ALLEGRO_AUDIO_STREAM *stream = TM_GetArg(action->arguments, 1);
-	char *text = TM_GetArg(action->arguments, 2);
-	bool player = TM_GetArg(action->arguments, 3);
+// Arguments of Speak and Draw actions, taken from data->cues instead of a TM_AddToArgs list per field.
+struct Cue {
+		struct GamestateResources *data;
+		ALLEGRO_AUDIO_STREAM *stream;
+		struct LoadTarget target; // stream is opened by the loader, once the previous line starts playing
+		char *path;
+		struct Cue *next; // the line after this one, so it can be prefetched
+		char *text;
+		bool player;
+		enum DialogueSymbol symbol;
+};
+
+struct StrokeSegment {
+		float x1, y1, x2, y2;
+};
+
+#define STROKE_SEGMENTS 4096
+#define STROKE_SPACING 2.0 // in canvas pixels
+#define STROKE_RADIUS 6.5 // half of the line thickness
+#define DRAWING_TOLERANCE 8.0 // how far off the guide a stroke can get before it stops counting at all
+
+#define METER_CELL 8 // in canvas pixels
+#define METER_BUDGET 0.0002 // seconds per frame the meter may take to catch up with the stroke
+#define METER_INSIDE 1
+#define METER_DRAWN 2
+
+#define BATCH_RECTANGLES 8
+#define STATS_FRAMES 600
+
+#define AUTOPLAY_SPEED 10 // logic steps per frame, unless set in the config
+#define AUTOPLAY_PASS_CHANCE 70 // percent of the drawings that are meant to pass
+#define AUTOPLAY_FAIL_PART 0.2 // how much of the symbol a failing drawing covers
+#define AUTOPLAY_RUNS 4 // rows of the symbol stroked per step
+#define AUTOPLAY_END_TICKS 600 // how long the ending is shown before starting over
+
+/*! \brief Untextured rectangles collected to be drawn with a single al_draw_prim. */
+struct RectangleBatch {
+		ALLEGRO_VERTEX v[BATCH_RECTANGLES * 6];
+		int count;
+};
+
+#define CUE_POOL_SIZE 32 // the longest dialogue node keeps 10 cues alive at once
+#define GLYPHS_PER_TICK 4 // how many glyphs of a new font FreeType gets to render on a logic tick
 
-	if (state == TM_ACTIONSTATE_INIT) {
-		al_set_audio_stream_playing(stream, false);
-		al_set_audio_stream_playmode(stream, ALLEGRO_PLAYMODE_ONCE);
+struct Cue* CreateCue(struct GamestateResources *data) {
+	struct Cue *cue = PoolAlloc(data->cues);
+	*cue = (struct Cue){ .data = data };
+	return cue;
+}
+
+#define COUNT_ASSET(...) + 1
+#define LOAD_TARGETS (0 DATE_ASSETS(COUNT_ASSET, COUNT_ASSET, COUNT_ASSET, COUNT_ASSET)) // one per asset queued by Gamestate_Load
+
+struct LoadTarget* NextLoadTarget(struct LoadTarget *targets, int *count, enum LoadTargetType type, void *ptr) {
+	assert(*count < LOAD_TARGETS);
+	struct LoadTarget *target = &targets[(*count)++];
+	*target = (struct LoadTarget){ .type = type, .ptr = ptr, .loading = true };
+	return target;
+}
+
+struct LoadTarget* NextCachedTarget(struct Game *game, struct LoadTarget *targets, int *count, char *name, int param, ALLEGRO_BITMAP **dest) {
+	// Returns NULL when the bitmap is still in the cache from the last time, otherwise a target to load it into.
+	struct LoadTarget *target = NextLoadTarget(targets, count, LOAD_TARGET_BITMAP, dest);
+	*dest = AcquireCached(game, "date", CACHE_BITMAP, name, param);
+	if (*dest) {
+		target->loading = false;
+		return NULL;
 	}
+	target->cache_name = name;
+	target->cache_param = param;
+	return target;
+}
+
+void AddBitmapJob(struct Game *game, struct LoadTarget *targets, int *count, char *filename, ALLEGRO_BITMAP **dest) {
+	// keyed the same way as AcquireBitmap, as FinishLoaderJob uploads them with these flags
+	struct LoadTarget *target = NextCachedTarget(game, targets, count, filename, game->data->quality.bitmap_flags, dest);
+	if (target) {
+		AddLoaderJob(game->data->loader, LoadMemoryBitmapWork, GetDataFilePath(game, filename), 0, target);
+	}
+}
+
+void AddLightJob(struct Game *game, struct LoadTarget *targets, int *count, int maxr, ALLEGRO_BITMAP **dest) {
+	struct LoadTarget *target = NextCachedTarget(game, targets, count, "light", maxr, dest);
+	if (target) {
+		AddLoaderJob(game->data->loader, GenerateLightWork, NULL, maxr, target);
+	}
+}
+
+void AddStreamJob(struct Game *game, struct LoadTarget *targets, int *count, char *filename, ALLEGRO_AUDIO_STREAM **dest) {
+	AddLoaderJob(game->data->loader, LoadAudioStreamWork, GetDataFilePath(game, filename), 0,
+	             NextLoadTarget(targets, count, LOAD_TARGET_STREAM, dest));
+}
+
+void AddSpritesheetJob(struct Game *game, struct LoadTarget *targets, int *count, struct Character *character, char *name) {
+	RegisterSpritesheet(game, character, name);
+	struct Spritesheet *sheet = character->spritesheets;
+	while (strcmp(sheet->name, name) != 0) {
+		sheet = sheet->next;
+	}
+	char filename[255];
+	snprintf(filename, 255, "sprites/%s/%s.png", character->name, name);
+	AddLoaderJob(game->data->loader, LoadSpriteWork, GetDataFilePath(game, filename), 0,
+	             NextLoadTarget(targets, count, LOAD_TARGET_SPRITESHEET, sheet));
+}
+
+static const char *coverage_pixel_shader =
+	"#ifdef GL_ES\n"
+	"precision mediump float;\n"
+	"#endif\n"
+	"uniform sampler2D " ALLEGRO_SHADER_VAR_TEX ";\n"
+	"varying vec4 varying_color;\n"
+	"varying vec2 varying_texcoord;\n"
+	"void main() {\n"
+	"	gl_FragColor = varying_color * texture2D(" ALLEGRO_SHADER_VAR_TEX ", varying_texcoord).rrrr;\n"
+	"}\n";
+
+bool CanRenderToCoverage(void) {
+	// Single channel textures aren't renderable everywhere (e.g. luminance ones on GLES 2), so try it out.
+	int format = al_get_new_bitmap_format();
+	al_set_new_bitmap_format(ALLEGRO_PIXEL_FORMAT_SINGLE_CHANNEL_8);
+	ALLEGRO_BITMAP *bitmap = al_create_bitmap(16, 16);
+	al_set_new_bitmap_format(format);
+	if (!bitmap) {
+		return false;
+	}
+	bool ok = false;
+	if (al_get_bitmap_format(bitmap) == ALLEGRO_PIXEL_FORMAT_SINGLE_CHANNEL_8) {
+		ALLEGRO_BITMAP *target = al_get_target_bitmap();
+		al_set_target_bitmap(bitmap);
+		al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+		al_draw_filled_rectangle(4, 4, 12, 12, al_map_rgb(255, 255, 255));
+		al_set_target_bitmap(target);
+
+		ALLEGRO_LOCKED_REGION *region = al_lock_bitmap(bitmap, ALLEGRO_PIXEL_FORMAT_SINGLE_CHANNEL_8, ALLEGRO_LOCK_READONLY);
+		if (region) {
+			unsigned char *d = region->data;
+			ok = (d[region->pitch * 8 + 8] == 255) && (d[0] == 0);
+			al_unlock_bitmap(bitmap);
+		}
+	}
+	al_destroy_bitmap(bitmap);
+	return ok;
+}
+
+ALLEGRO_SHADER* CreateCoverageShader(struct Game *game) {
+	// Returns NULL when coverage bitmaps can't be used, in which case everything stays RGBA.
+	if (!game->display || !(al_get_display_flags(game->display) & ALLEGRO_PROGRAMMABLE_PIPELINE) || !CanRenderToCoverage()) {
+		PrintConsole(game, "Single channel bitmaps not supported, using RGBA for canvas and symbols.");
+		return NULL;
+	}
+	ALLEGRO_SHADER *shader = al_create_shader(ALLEGRO_SHADER_GLSL);
+	if (!shader || !al_attach_shader_source(shader, ALLEGRO_VERTEX_SHADER, al_get_default_shader_source(ALLEGRO_SHADER_GLSL, ALLEGRO_VERTEX_SHADER)) ||
+	    !al_attach_shader_source(shader, ALLEGRO_PIXEL_SHADER, coverage_pixel_shader) || !al_build_shader(shader)) {
+		PrintConsole(game, "Could not build coverage shader, using RGBA for canvas and symbols. %s", shader ? al_get_shader_log(shader) : "");
+		if (shader) {
+			al_destroy_shader(shader);
+		}
+		return NULL;
+	}
+	return shader;
+}
+
+ALLEGRO_BITMAP* CreateCoverageBitmap(ALLEGRO_BITMAP *bitmap) {
+	// Takes the alpha out of a decoded memory bitmap; as they're white, that's all there is to them.
+	// If that can't be done, the bitmap is kept as it is, which the coverage shader draws the same.
+	int width = al_get_bitmap_width(bitmap), height = al_get_bitmap_height(bitmap);
+	int format = al_get_new_bitmap_format();
+	al_set_new_bitmap_format(ALLEGRO_PIXEL_FORMAT_SINGLE_CHANNEL_8);
+	ALLEGRO_BITMAP *coverage = al_create_bitmap(width, height);
+	al_set_new_bitmap_format(format);
+
+	ALLEGRO_LOCKED_REGION *src = NULL, *dst = NULL;
+	if (coverage) {
+		src = al_lock_bitmap(bitmap, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY);
+		dst = src ? al_lock_bitmap(coverage, ALLEGRO_PIXEL_FORMAT_SINGLE_CHANNEL_8, ALLEGRO_LOCK_WRITEONLY) : NULL;
+	}
+	if (!dst) {
+		if (src) {
+			al_unlock_bitmap(bitmap);
+		}
+		al_destroy_bitmap(coverage);
+		al_convert_bitmap(bitmap);
+		return bitmap;
+	}
+	for (int y = 0; y < height; y++) {
+		unsigned char *s = (unsigned char*)src->data + src->pitch * y;
+		unsigned char *d = (unsigned char*)dst->data + dst->pitch * y;
+		for (int x = 0; x < width; x++) {
+			d[x] = s[x * 4 + 3];
+		}
+	}
+	al_unlock_bitmap(coverage);
+	al_unlock_bitmap(bitmap);
+	al_destroy_bitmap(bitmap);
+	return coverage;
+}
+
+void WarmFont(struct Game *game, struct LoadTarget *target, ALLEGRO_FONT *font) {
+	// A TTF glyph is only rendered once it's drawn, on the display thread, so a new font doesn't replace
+	// the one in use until Gamestate_Logic has rendered the date's glyphs with it, a few on each tick.
+	ReleaseCached(game, "date", target->warming);
+	target->warming = font;
+	target->warmed = 0;
+}
+
+void WarmGlyphs(struct Game *game, struct GamestateResources *data, struct LoadTarget *target) {
+	ALLEGRO_FONT *font = target->warming;
+	if (!font) {
+		return;
+	}
+	ALLEGRO_BITMAP *bitmap = al_get_target_bitmap();
+	al_set_target_bitmap(data->glyph_target);
+	for (int i = 0; (i < GLYPHS_PER_TICK) && (target->warmed < data->glyph_count); i++) {
+		al_draw_glyph(font, al_map_rgba(0, 0, 0, 0), 0, 0, data->glyphs[target->warmed++]);
+	}
+	al_set_target_bitmap(bitmap);
+	if (target->warmed < data->glyph_count) {
+		return;
+	}
+	ReleaseCached(game, "date", *(ALLEGRO_FONT**)target->ptr);
+	*(ALLEGRO_FONT**)target->ptr = font;
+	target->warming = NULL;
+}
+
+void AddGlyphs(struct GamestateResources *data, const char *text) {
+	ALLEGRO_USTR_INFO info;
+	const ALLEGRO_USTR *ustr = al_ref_cstr(&info, text);
+	int pos = 0, c;
+	while ((c = al_ustr_get_next(ustr, &pos)) >= 0) {
+		int i = 0;
+		while ((i < data->glyph_count) && (data->glyphs[i] != c)) {
+			i++;
+		}
+		if (i == data->glyph_count) {
+			data->glyphs = realloc(data->glyphs, (data->glyph_count + 1) * sizeof(int));
+			data->glyphs[data->glyph_count++] = c;
+		}
+	}
+}
+
+void RequestFont(struct Game *game, struct LoadTarget *target, int size) {
+	// The font in use is kept until the one in the new size is there, so the text never goes missing.
+	target->cache_param = size;
+	if (target->loading) {
+		return; // FinishLoaderJob asks again once the one on the way is done
+	}
+	ALLEGRO_FONT *cached = AcquireCached(game, "date", CACHE_FONT, target->cache_name, size);
+	if (cached) {
+		WarmFont(game, target, cached); // most likely rendered them all already, which makes it quick
+		return;
+	}
+	target->loading = true;
+	AddLoaderJob(game->data->loader, LoadFontWork, GetDataFilePath(game, target->cache_name), size, target);
+}
+
+void FinishLoaderJob(struct Game *game, struct LoaderJob *job) {
+	// Runs on the display thread, so that's where the decoded bitmaps get uploaded to the GPU.
+	if (!job->result) {
+		PrintConsole(game, "ERROR: Could not load %s!", job->path);
+	}
+	struct LoadTarget *target = job->data;
+	target->loading = false;
+	if (target->type == LOAD_TARGET_STREAM) {
+		*(ALLEGRO_AUDIO_STREAM**)target->ptr = TrackStream(game, "date", job->path, job->result);
+		return;
+	}
+	if (target->type == LOAD_TARGET_FONT) {
+		ALLEGRO_FONT *font = StoreCached(game, "date", CACHE_FONT, target->cache_name, job->param, job->result);
+		if (job->param != target->cache_param) {
+			// the viewport changed again in the meantime; this one stays idle in the cache in case it changes back
+			ReleaseCached(game, "date", font);
+			RequestFont(game, target, target->cache_param);
+		} else if (font) {
+			WarmFont(game, target, font);
+		}
+		return;
+	}
+	if (job->result && target->field) {
+		ALLEGRO_LOCKED_REGION *region = al_lock_bitmap(job->result, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_READONLY);
+		*target->field = CreateDistanceField((unsigned char*)region->data + 3, al_get_bitmap_width(job->result),
+		                                     al_get_bitmap_height(job->result), region->pitch, 4, 2);
+		al_unlock_bitmap(job->result);
+	}
+	if (job->result) {
+		// this may run from Gamestate_Logic as well, so don't rely on whatever flags are set at that time
+		int flags = al_get_new_bitmap_flags();
+		al_set_new_bitmap_flags(game->data->quality.bitmap_flags);
+		if (target->format == ALLEGRO_PIXEL_FORMAT_SINGLE_CHANNEL_8) {
+			job->result = CreateCoverageBitmap(job->result);
+		} else {
+			al_convert_bitmap(job->result);
+		}
+		al_set_new_bitmap_flags(flags);
+		if (target->cache_name) {
+			job->result = StoreCached(game, "date", CACHE_BITMAP, target->cache_name, target->cache_param, job->result);
+		} else {
+			TrackBitmap(game, "date", job->path ? job->path : "light", job->result);
+		}
+	}
+	if (target->type == LOAD_TARGET_SPRITESHEET) {
+		struct Spritesheet *sheet = target->ptr;
+		sheet->bitmap = job->result;
+		if (sheet->bitmap) {
+			sheet->width = al_get_bitmap_width(sheet->bitmap);
+			sheet->height = al_get_bitmap_height(sheet->bitmap);
+		}
+	} else {
+		*(ALLEGRO_BITMAP**)target->ptr = job->result;
+	}
+}
+
+void UntrackCharacter(struct Game *game, struct Character *character) {
+	// the spritesheets get destroyed by DestroyCharacter
+	for (struct Spritesheet *tmp = character->spritesheets; tmp; tmp = tmp->next) {
+		UntrackAsset(game, tmp->bitmap);
+	}
+}
+
+void WaitForLoadTarget(struct Game *game, struct LoadTarget *target) {
+	// Finishes loader jobs until the one for target is done, blocking if it's still being decoded.
+	while (target->loading) {
+		struct LoaderJob *job = WaitForLoaderJob(game->data->loader);
+		if (!job) {
+			break;
+		}
+		FinishLoaderJob(game, job);
+		DestroyLoaderJob(job);
+	}
+}
+
+void InitResident(struct Resident *res, enum LoadTargetType type, void *ptr, char *path, int from, int to) {
+	res->target = (struct LoadTarget){ .type = type, .ptr = ptr };
+	res->path = strdup(path);
+	res->from = from;
+	res->to = to;
+}
+
+bool IsResident(struct Resident *res) {
+	if (res->target.type == LOAD_TARGET_SPRITESHEET) {
+		return ((struct Spritesheet*)res->target.ptr)->bitmap;
+	}
+	return *(void**)res->target.ptr;
+}
+
+bool IsResidentWanted(struct Resident *res, int stage) {
+	return (res->from <= res->to) && (stage >= res->from - 1) && (stage <= res->to + 1);
+}
+
+void QueueResident(struct Game *game, struct Resident *res) {
+	res->target.loading = true;
+	void (*work)(struct LoaderJob*) = LoadMemoryBitmapWork;
+	if (res->target.type == LOAD_TARGET_STREAM) {
+		work = LoadAudioStreamWork;
+	} else if (res->target.type == LOAD_TARGET_SPRITESHEET) {
+		work = LoadSpriteWork;
+	}
+	AddLoaderJob(game->data->loader, work, res->path, 0, &res->target);
+}
+
+void EvictResident(struct Game *game, struct Resident *res) {
+	PrintConsole(game, "Evicting %s", res->path);
+	if (res->target.field) {
+		DestroyDistanceField(*res->target.field);
+		*res->target.field = NULL;
+	}
+	switch (res->target.type) {
+		case LOAD_TARGET_SPRITESHEET: {
+			struct Spritesheet *sheet = res->target.ptr;
+			DestroyTrackedBitmap(game, sheet->bitmap);
+			sheet->bitmap = NULL;
+			break;
+		}
+		case LOAD_TARGET_STREAM:
+			DestroyTrackedStream(game, *(ALLEGRO_AUDIO_STREAM**)res->target.ptr);
+			*(ALLEGRO_AUDIO_STREAM**)res->target.ptr = NULL;
+			break;
+		case LOAD_TARGET_BITMAP:
+			DestroyTrackedBitmap(game, *(ALLEGRO_BITMAP**)res->target.ptr);
+			*(ALLEGRO_BITMAP**)res->target.ptr = NULL;
+			break;
+		case LOAD_TARGET_FONT: // fonts aren't residents
+			break;
+	}
+}
+
+void RequireResident(struct Game *game, struct Resident *res) {
+	// For when it's about to be used; only blocks if the prefetch didn't make it in time.
+	if (!IsResident(res) && !res->target.loading) {
+		QueueResident(game, res);
+	}
+	WaitForLoadTarget(game, &res->target);
+}
+
+void UpdateResidency(struct Game *game, struct GamestateResources *data) {
+	struct LoaderJob *job;
+	while ((job = PollLoaderJob(game->data->loader))) {
+		FinishLoaderJob(game, job);
+		DestroyLoaderJob(job);
+	}
+	for (int i = 0; i < RESIDENT_COUNT; i++) {
+		struct Resident *res = &data->residents[i];
+		if (IsResidentWanted(res, data->stage)) {
+			if ((data->stage >= res->from) && (data->stage <= res->to)) {
+				RequireResident(game, res);
+			} else if (!IsResident(res) && !res->target.loading) {
+				QueueResident(game, res);
+			}
+		} else if (IsResident(res) && !res->target.loading) {
+			EvictResident(game, res);
+		}
+	}
+}
+
+void QueueCueStream(struct Game *game, struct Cue *cue) {
+	cue->target = (struct LoadTarget){ .type = LOAD_TARGET_STREAM, .ptr = &cue->stream, .loading = true };
+	AddLoaderJob(game->data->loader, LoadAudioStreamWork, cue->path, 0, &cue->target);
+}
+
+bool Speak(struct Game *game, struct TM_Action *action, enum TM_ActionState state) {
+	struct Cue *cue = TM_GetArg(action->arguments, 0);
+	struct GamestateResources *data = cue->data;
+	char *text = cue->text;
+	bool player = cue->player;
 
 	if (state == TM_ACTIONSTATE_START) {
-		data->skip = false;
+		// Voices are opened lazily; this one has usually been prefetched while the previous line was playing.
+		if (!cue->stream && !cue->target.loading) {
+			QueueCueStream(game, cue);
+		}
+		WaitForLoadTarget(game, &cue->target);
+		if (cue->next) {
+			QueueCueStream(game, cue->next);
+		}
+
+		data->skip = data->autoplay; // nobody is listening
 		data->text = text;
 		data->player = player;
-		//al_rewind_audio_stream(stream);
-		al_attach_audio_stream_to_mixer(stream, game->audio.voice);
-		al_set_audio_stream_playing(stream, true);
+		if (cue->stream) {
+			al_set_audio_stream_playmode(cue->stream, ALLEGRO_PLAYMODE_ONCE);
+			//al_rewind_audio_stream(stream);
+			al_attach_audio_stream_to_mixer(cue->stream, game->audio.voice);
+			al_set_audio_stream_playing(cue->stream, true);
+		}
 	}
 
 	if (state == TM_ACTIONSTATE_RUNNING) {
-		return !al_get_audio_stream_playing(stream) || data->skip;
+		return !cue->stream || !al_get_audio_stream_playing(cue->stream) || data->skip;
 	}
 
 	if (state == TM_ACTIONSTATE_DESTROY) {
-		al_destroy_audio_stream(stream);
+		DestroyTrackedStream(game, cue->stream);
 		data->text = NULL;
+		PoolFree(data->cues, cue);
+		data->actions--;
 	}
 	return false;
 }
@@ -113,6 +669,10 @@ bool NextStage(struct Game *game, struct TM_Action *action, enum TM_ActionState
 		return true;
 	}
 
+	if (state == TM_ACTIONSTATE_DESTROY) {
+		data->actions--;
+	}
+
 	return false;
 }
 
@@ -120,7 +680,12 @@ bool End(struct Game *game, struct TM_Action *action, enum TM_ActionState state)
 	struct GamestateResources *data = TM_GetArg(action->arguments, 0);
 
 	if (state == TM_ACTIONSTATE_START) {
-		al_set_audio_stream_playing(data->careless, true);
+		RequireResident(game, &data->residents[RESIDENT_CARELESS]);
+		if (data->careless) {
+			al_attach_audio_stream_to_mixer(data->careless, game->audio.music);
+			al_set_audio_stream_playmode(data->careless, ALLEGRO_PLAYMODE_LOOP);
+			al_set_audio_stream_playing(data->careless, true);
+		}
 		data->end = true;
 	}
 
@@ -128,17 +693,287 @@ bool End(struct Game *game, struct TM_Action *action, enum TM_ActionState state)
 		return true;
 	}
 
+	if (state == TM_ACTIONSTATE_DESTROY) {
+		data->actions--;
+	}
+
 	return false;
 }
 
 bool DecideWhatToDo(struct Game *game, struct TM_Action *action, enum TM_ActionState state);
+bool Draw(struct Game *game, struct TM_Action *action, enum TM_ActionState state);
+
+void QueueAction(struct GamestateResources *data, bool (*func)(struct Game*, struct TM_Action*, enum TM_ActionState), void *arg, char *name) {
+	// every action decrements data->actions when destroyed, so the ones piling up can be noticed
+	TM_AddAction(data->timeline, func, TM_AddToArgs(NULL, 1, arg), name);
+	data->actions++;
+}
+
+struct DialogueStage* GetDialogueStage(struct Dialogue *dialogue, int stage) {
+	if (!dialogue || (stage < 1) || (stage > dialogue->stage_count)) {
+		return NULL;
+	}
+	return &dialogue->stages[stage - 1];
+}
+
+void RunDialogue(struct Game *game, struct GamestateResources *data, enum DialogueNode node) {
+	// Walks the given node of the current stage, queueing its actions on the timeline.
+	struct Dialogue *dialogue = data->dialogue;
+	struct DialogueStage *stage = GetDialogueStage(dialogue, data->stage);
+	if (!stage) {
+		return;
+	}
+	int pc = stage->node[node];
+	if (pc == DIALOGUE_NONE) {
+		return;
+	}
+	struct Cue *last = NULL; // the previous line, which prefetches the next one once it starts
+
+	while (true) {
+		struct DialogueOp *op = &dialogue->ops[pc++];
+		switch (op->opcode) {
+			case DIALOGUE_OP_RETURN:
+				return;
+			case DIALOGUE_OP_SAY: {
+				struct Cue *cue = CreateCue(data);
+				cue->path = dialogue->voices[op->a];
+				cue->text = (op->b == DIALOGUE_NONE) ? NULL : dialogue->strings[op->b];
+				cue->player = (op->arg == DIALOGUE_SPEAKER_PLAYER);
+				if (last) {
+					last->next = cue;
+				} else {
+					QueueCueStream(game, cue);
+				}
+				last = cue;
+				QueueAction(data, &Speak, cue, "speak");
+				break;
+			}
+			case DIALOGUE_OP_JUMP:
+				pc = op->a;
+				break;
+			case DIALOGUE_OP_JUMP_IF:
+				if (data->facts[op->arg]) {
+					pc = op->a;
+				}
+				break;
+			case DIALOGUE_OP_JUMP_UNLESS:
+				if (!data->facts[op->arg]) {
+					pc = op->a;
+				}
+				break;
+			case DIALOGUE_OP_SET:
+				data->facts[op->arg] = true;
+				break;
+			case DIALOGUE_OP_DRAW: {
+				struct Cue *cue = CreateCue(data);
+				cue->symbol = op->arg;
+				QueueAction(data, &Draw, cue, "draw");
+				break;
+			}
+			case DIALOGUE_OP_STAGE:
+				data->stage += (signed char)op->arg;
+				break;
+			case DIALOGUE_OP_NEXTSTAGE:
+				QueueAction(data, &NextStage, data, "nextstage");
+				break;
+			case DIALOGUE_OP_DECIDE:
+				QueueAction(data, &DecideWhatToDo, data, "decidewhattodo");
+				break;
+			case DIALOGUE_OP_END:
+				QueueAction(data, &End, data, "end");
+				break;
+		}
+	}
+}
+
+void DestroyDialogue(struct Dialogue *dialogue) {
+	if (!dialogue) {
+		return;
+	}
+	for (int i = 0; i < dialogue->string_count; i++) {
+		free(dialogue->voices[i]);
+	}
+	free(dialogue->voices);
+	free(dialogue->strings);
+	free(dialogue->blob);
+	free(dialogue->ops);
+	free(dialogue->stages);
+	free(dialogue);
+}
+
+bool ValidateDialogue(struct Dialogue *dialogue) {
+	for (int i = 0; i < dialogue->stage_count; i++) {
+		for (int j = 0; j < DIALOGUE_NODE_COUNT; j++) {
+			int node = dialogue->stages[i].node[j];
+			if ((node != DIALOGUE_NONE) && (node >= dialogue->op_count)) {
+				return false;
+			}
+		}
+	}
+	if (dialogue->op_count && (dialogue->ops[dialogue->op_count - 1].opcode != DIALOGUE_OP_RETURN)) {
+		return false;
+	}
+	for (int i = 0; i < dialogue->op_count; i++) {
+		struct DialogueOp *op = &dialogue->ops[i];
+		switch (op->opcode) {
+			case DIALOGUE_OP_SAY:
+				if ((op->a >= dialogue->string_count) || ((op->b != DIALOGUE_NONE) && (op->b >= dialogue->string_count))) {
+					return false;
+				}
+				break;
+			case DIALOGUE_OP_JUMP:
+				if ((op->a >= dialogue->op_count) || (op->a <= i)) { // forward only, so RunDialogue always gets to a return
+					return false;
+				}
+				break;
+			case DIALOGUE_OP_JUMP_IF:
+			case DIALOGUE_OP_JUMP_UNLESS:
+				if ((op->a >= dialogue->op_count) || (op->a <= i) || (op->arg >= DIALOGUE_FACT_COUNT)) {
+					return false;
+				}
+				break;
+			case DIALOGUE_OP_SET:
+				if (op->arg >= DIALOGUE_FACT_COUNT) {
+					return false;
+				}
+				break;
+			case DIALOGUE_OP_DRAW:
+				if (op->arg >= DIALOGUE_SYMBOL_COUNT) {
+					return false;
+				}
+				break;
+			default:
+				if (op->opcode >= DIALOGUE_OP_COUNT) {
+					return false;
+				}
+		}
+	}
+	return true;
+}
+
+struct Dialogue* LoadDialogue(struct Game *game, char *filename) {
+	char *path = NULL;
+#ifdef BLINDDATE_BUILD_DATA
+	// it's generated by the build, so when running from the tree it's in the build directory and not with the rest
+	char built[4096];
+	snprintf(built, sizeof(built), "%s/%s", BLINDDATE_BUILD_DATA, filename);
+	if (al_filename_exists(built)) {
+		path = built;
+	}
+#endif
+	ALLEGRO_FILE *file = al_fopen(path ? path : GetDataFilePath(game, filename), "rb");
+	if (!file) {
+		PrintConsole(game, "ERROR: Could not open dialogue table %s!", filename);
+		return NULL;
+	}
+	int64_t size = al_fsize(file);
+	unsigned char *buf = (size > DIALOGUE_HEADER_SIZE) ? malloc(size) : NULL;
+	if (!buf || (al_fread(file, buf, size) != (size_t)size)) {
+		PrintConsole(game, "ERROR: Could not read dialogue table %s!", filename);
+		free(buf);
+		al_fclose(file);
+		return NULL;
+	}
+	al_fclose(file);
+
+	struct Dialogue *dialogue = calloc(1, sizeof(struct Dialogue));
+	dialogue->stage_count = DialogueReadU16(buf + 6);
+	dialogue->op_count = DialogueReadU16(buf + 8);
+	dialogue->string_count = DialogueReadU16(buf + 10);
+	uint32_t string_bytes = DialogueReadU32(buf + 12);
+
+	unsigned char *stages = buf + DIALOGUE_HEADER_SIZE;
+	unsigned char *ops = stages + dialogue->stage_count * DIALOGUE_STAGE_SIZE;
+	unsigned char *strings = ops + dialogue->op_count * DIALOGUE_OP_SIZE;
+
+	if (memcmp(buf, DIALOGUE_MAGIC, 4) || (DialogueReadU16(buf + 4) != DIALOGUE_VERSION) ||
+	    (strings + string_bytes != buf + size) || (string_bytes && strings[string_bytes - 1])) {
+		PrintConsole(game, "ERROR: Invalid dialogue table %s!", filename);
+		free(buf);
+		free(dialogue);
+		return NULL;
+	}
+
+	dialogue->stages = calloc(dialogue->stage_count, sizeof(struct DialogueStage));
+	for (int i = 0; i < dialogue->stage_count; i++) {
+		unsigned char *p = stages + i * DIALOGUE_STAGE_SIZE;
+		dialogue->stages[i].score1 = DialogueReadU16(p) / 1000.0;
+		dialogue->stages[i].score2 = DialogueReadU16(p + 2) / 1000.0;
+		for (int j = 0; j < DIALOGUE_NODE_COUNT; j++) {
+			dialogue->stages[i].node[j] = DialogueReadU16(p + 4 + j * 2);
+		}
+	}
+
+	dialogue->ops = calloc(dialogue->op_count, sizeof(struct DialogueOp));
+	for (int i = 0; i < dialogue->op_count; i++) {
+		unsigned char *p = ops + i * DIALOGUE_OP_SIZE;
+		dialogue->ops[i] = (struct DialogueOp){ .opcode = p[0], .arg = p[1], .a = DialogueReadU16(p + 2), .b = DialogueReadU16(p + 4) };
+	}
+
+	dialogue->blob = malloc(string_bytes);
+	memcpy(dialogue->blob, strings, string_bytes);
+	dialogue->strings = calloc(dialogue->string_count, sizeof(char*));
+	dialogue->voices = calloc(dialogue->string_count, sizeof(char*));
+	char *str = dialogue->blob;
+	for (int i = 0; i < dialogue->string_count; i++) {
+		if (str >= dialogue->blob + string_bytes) {
+			dialogue->string_count = i;
+			break;
+		}
+		dialogue->strings[i] = str;
+		str += strlen(str) + 1;
+	}
+	free(buf);
+
+	if (!ValidateDialogue(dialogue)) {
+		PrintConsole(game, "ERROR: Invalid dialogue table %s!", filename);
+		DestroyDialogue(dialogue);
+		return NULL;
+	}
+
+	// The whole graph is known up front, so resolve every voice file once instead of on each line.
+	for (int i = 0; i < dialogue->op_count; i++) {
+		struct DialogueOp *op = &dialogue->ops[i];
+		if ((op->opcode == DIALOGUE_OP_SAY) && !dialogue->voices[op->a]) {
+			dialogue->voices[op->a] = strdup(GetDataFilePath(game, dialogue->strings[op->a]));
+		}
+	}
+
+	PrintConsole(game, "Dialogue: %d stages, %d ops, %d strings", dialogue->stage_count, dialogue->op_count, dialogue->string_count);
+	return dialogue;
+}
+
+void GetSymbolStages(struct Dialogue *dialogue, enum DialogueSymbol symbol, int *from, int *to) {
+	// Finds the stages whose nodes ask for drawing the given symbol.
+	*from = 0;
+	*to = -1;
+	for (int i = 0; dialogue && (i < dialogue->stage_count); i++) {
+		for (int j = 0; j < DIALOGUE_NODE_COUNT; j++) {
+			int pc = dialogue->stages[i].node[j];
+			if (pc == DIALOGUE_NONE) {
+				continue;
+			}
+			// jumps only ever go forward inside of a node, so this sees all of it
+			for (; dialogue->ops[pc].opcode != DIALOGUE_OP_RETURN; pc++) {
+				if ((dialogue->ops[pc].opcode == DIALOGUE_OP_DRAW) && (dialogue->ops[pc].arg == symbol)) {
+					if (*from > *to) {
+						*from = i + 1;
+					}
+					*to = i + 1;
+				}
+			}
+		}
+	}
+}
 
 void CalculateScore(struct Game *game, struct GamestateResources* data) {
 	int width = al_get_bitmap_width(data->canvas);
 	int height = al_get_bitmap_height(data->canvas);
-	ALLEGRO_LOCKED_REGION *region = al_lock_bitmap(data->canvas, ALLEGRO_PIXEL_FORMAT_RGBA_8888, ALLEGRO_LOCK_READONLY);
+	// with RGBA_8888, the first byte of a pixel is its alpha on little endian and red (premultiplied) otherwise
+	int format = data->coverage ? ALLEGRO_PIXEL_FORMAT_SINGLE_CHANNEL_8 : ALLEGRO_PIXEL_FORMAT_RGBA_8888;
+	ALLEGRO_LOCKED_REGION *region = al_lock_bitmap(data->canvas, format, ALLEGRO_LOCK_READONLY);
 
-	ALLEGRO_LOCKED_REGION *region2 = al_lock_bitmap(data->drawbmp, ALLEGRO_PIXEL_FORMAT_RGBA_8888, ALLEGRO_LOCK_READONLY);
+	ALLEGRO_LOCKED_REGION *region2 = al_lock_bitmap(data->drawbmp, format, ALLEGRO_LOCK_READONLY);
 
 	char *d = region->data;
 	char *mask = region2->data;
@@ -149,13 +984,13 @@ void CalculateScore(struct Game *game, struct GamestateResources* data) {
 			//	d[x * region->pixel_size + region->pitch * y + z]--;
 			//}
 			if (d[x * region->pixel_size + region->pitch * y]) {
-				if (mask[x * region->pixel_size + region->pitch * y]) {
+				if (mask[x * region2->pixel_size + region2->pitch * y]) {
 					white++;
 				} else {
 					black++;
 				}
 			}
-			if (mask[x * region->pixel_size + region->pitch * y]) {
+			if (mask[x * region2->pixel_size + region2->pitch * y]) {
 				if (d[x * region->pixel_size + region->pitch * y]) {
 					white2++;
 				} else {
@@ -178,232 +1013,498 @@ void CalculateScore(struct Game *game, struct GamestateResources* data) {
 
 }
 
-bool Draw(struct Game *game, struct TM_Action *action, enum TM_ActionState state) {
-	struct GamestateResources *data = TM_GetArg(action->arguments, 0);
-	ALLEGRO_BITMAP *bmp = TM_GetArg(action->arguments, 1);
+void AddStrokeSegment(struct GamestateResources *data, float x1, float y1, float x2, float y2) {
+	if (data->stroke_count < STROKE_SEGMENTS) {
+		data->stroke[data->stroke_count++] = (struct StrokeSegment){ x1, y1, x2, y2 };
+	}
+}
 
-	if (state == TM_ACTIONSTATE_START) {
-		data->drawing = true;
-		data->time = 60*6;
-		data->timeleft = data->time;
-		data->button = false;
-		data->drawbmp = bmp;
-		data->score1 = 0;
-		data->score2 = 0;
+void ResetPrediction(struct StrokePrediction *prediction) {
+	prediction->count = 0;
+}
 
-		al_set_target_bitmap(data->canvas);
-		al_clear_to_color(al_map_rgba(0, 0, 0, 0));
-		al_set_target_backbuffer(game->display);
+void RecordPrediction(struct StrokePrediction *prediction, float x, float y, double time) {
+	if (prediction->count && (time <= prediction->samples[prediction->count - 1].time)) {
+		// delivered along with the previous one
+		prediction->samples[prediction->count - 1].x = x;
+		prediction->samples[prediction->count - 1].y = y;
+		return;
+	}
+	if (prediction->count == PREDICT_SAMPLES) {
+		memmove(&prediction->samples[0], &prediction->samples[1], (PREDICT_SAMPLES - 1) * sizeof(prediction->samples[0]));
+		prediction->count--;
+	}
+	prediction->samples[prediction->count].x = x;
+	prediction->samples[prediction->count].y = y;
+	prediction->samples[prediction->count].time = time;
+	prediction->count++;
+}
 
-		al_hide_mouse_cursor(game->display);
+bool PredictStroke(struct StrokePrediction *prediction, double now, float *x, float *y) {
+	// Where the finger likely is by the time this frame shows up, from the velocity of the last touch positions
+	// and their acceleration once there are enough of them. It's only drawn over the canvas, so it can be wrong.
+	if (prediction->count < 2) {
+		return false;
+	}
+	int last = prediction->count - 1;
+	float x1 = prediction->samples[last].x, y1 = prediction->samples[last].y;
+	float x0 = prediction->samples[last - 1].x, y0 = prediction->samples[last - 1].y;
+	double dt = prediction->samples[last].time - prediction->samples[last - 1].time;
+	double age = now - prediction->samples[last].time;
+	if ((dt <= 0) || (age > PREDICT_HORIZON)) {
+		return false;
+	}
+	double h = fmin(age + PREDICT_LEAD, PREDICT_HORIZON);
+
+	double vx = (x1 - x0) / dt, vy = (y1 - y0) / dt, ax = 0, ay = 0;
+	if (last >= 2) {
+		double dt0 = prediction->samples[last - 1].time - prediction->samples[last - 2].time;
+		if (dt0 > 0) {
+			double vx0 = (x0 - prediction->samples[last - 2].x) / dt0, vy0 = (y0 - prediction->samples[last - 2].y) / dt0;
+			ax = (vx - vx0) / ((dt + dt0) / 2);
+			ay = (vy - vy0) / ((dt + dt0) / 2);
+		}
+	}
+	double dx = vx * h + ax * h * h / 2, dy = vy * h + ay * h * h / 2;
+	double len = sqrt(dx * dx + dy * dy);
+	if (len < 0.5) {
+		return false;
 	}
+	if (len > PREDICT_DISTANCE) {
+		dx *= PREDICT_DISTANCE / len;
+		dy *= PREDICT_DISTANCE / len;
+	}
+	*x = x1 + dx;
+	*y = y1 + dy;
+	return true;
+}
 
-	if (state == TM_ACTIONSTATE_RUNNING) {
-		if (!data->drawing) {
+void DrawStrokeSegment(struct GamestateResources *data, float x, float y) {
+	// from the last position to the given one, onto the canvas and into the stroke buffer
+	ALLEGRO_BITMAP *target = al_get_target_bitmap();
+	al_set_target_bitmap(data->canvas);
+	al_draw_line(data->x, data->y, x, y, al_map_rgb(255,255,255), 13);
+	AddStrokeSegment(data, data->x, data->y, x, y);
+	al_draw_filled_rounded_rectangle(x-5, y-5, x+5, y+5, 2, 2, al_map_rgb(255,255,255));
 
-			// points counting
+	al_set_target_bitmap(target);
+}
 
-			if (!game->config.fullscreen) {
-				al_show_mouse_cursor(game->display);
-			}
+void ResetCoverage(struct StrokeCoverage *coverage, struct DistanceField *field) {
+	coverage->width = (field->width + 1) / 2;
+	coverage->height = (field->height + 1) / 2;
+	int size = coverage->width * coverage->height;
+	if (size > coverage->size) {
+		free(coverage->nearest);
+		coverage->nearest = malloc(size * sizeof(float));
+		coverage->size = size;
+	}
+	for (int i = 0; i < size; i++) {
+		coverage->nearest[i] = INFINITY;
+	}
+	coverage->sum = 0;
+}
 
-			bool won = true;
+static inline float CoverageAt(float nearest) {
+	return (nearest <= STROKE_RADIUS) ? 1 : fmax(0, 1 - (nearest - STROKE_RADIUS) / DRAWING_TOLERANCE);
+}
 
-			CalculateScore(game, data);
-			PrintConsole(game, "score1: %f%%, score2: %f%%", data->score1 * 100, data->score2 * 100);
+void AddCoverageSegment(struct StrokeCoverage *coverage, struct DistanceField *field, struct StrokeSegment *seg) {
+	// only the cells close enough to get anything out of the segment are visited
+	float reach = STROKE_RADIUS + DRAWING_TOLERANCE;
+	float step = field->scale * 2, offset = field->scale * 0.5;
+	int x1 = fmax(0, ceil((fmin(seg->x1, seg->x2) - reach - offset) / step));
+	int x2 = fmin(coverage->width - 1, floor((fmax(seg->x1, seg->x2) + reach - offset) / step));
+	int y1 = fmax(0, ceil((fmin(seg->y1, seg->y2) - reach - offset) / step));
+	int y2 = fmin(coverage->height - 1, floor((fmax(seg->y1, seg->y2) + reach - offset) / step));
+	for (int y = y1; y <= y2; y++) {
+		for (int x = x1; x <= x2; x++) {
+			if (field->d[y * 2 * field->width + x * 2] > 0) {
+				continue; // not one of the samples
+			}
+			float *nearest = &coverage->nearest[y * coverage->width + x];
+			float d = DistanceToSegment(x * step + offset, y * step + offset, seg->x1, seg->y1, seg->x2, seg->y2);
+			if (d < *nearest) {
+				coverage->sum += CoverageAt(d) - CoverageAt(*nearest);
+				*nearest = d;
+			}
+		}
+	}
+}
 
-			if (data->stage == 1) {
+void AddAccuracySegment(struct DistanceField *field, struct StrokeSegment *seg, float *sum, float *total) {
+	// sampled along the segment by length; a single click still leaves a dot
+	float len = hypot(seg->x2 - seg->x1, seg->y2 - seg->y1);
+	int steps = fmax(1, ceil(len / STROKE_SPACING));
+	float weight = len ? (len / steps) : STROKE_SPACING;
+	for (int j = 0; j < steps; j++) {
+		float t = (j + 0.5) / steps;
+		float d = SampleDistanceField(field, seg->x1 + (seg->x2 - seg->x1) * t, seg->y1 + (seg->y2 - seg->y1) * t);
+		*sum += ((d <= 0) ? 1 : fmax(0, 1 - d / DRAWING_TOLERANCE)) * weight;
+		*total += weight;
+	}
+}
 
-				won = (data->score1 > 0.75) && (data->score2 > 0.45);
+void CalculateDistanceScore(struct GamestateResources *data) {
+	// Like CalculateScore, but straight from the stroke segments, so there's nothing to read back from the canvas
+	// and a stroke that's only slightly off the guide still counts for some of it.
+	struct DistanceField *field = data->drawfield;
+	data->distance1 = 0;
+	data->distance2 = 0;
+	if (!field || !data->stroke_count) {
+		return;
+	}
 
-				if (data->cheat) {
-					won = true;
-					data->cheat = false;
-				}
+	// percentage of drawing inside the symbol, weighted by length
+	float sum = 0, total = 0;
+	for (int i = 0; i < data->stroke_count; i++) {
+		AddAccuracySegment(field, &data->stroke[i], &sum, &total);
+	}
+	data->distance1 = sum / total;
 
-				if (won) {
-					TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-					             al_load_audio_stream(GetDataFilePath(game, "voices/player-04.flac"), 4, 1024),
-					             "Umm, Nolan.", true), "speak");
-					data->stage++;
-					TM_AddAction(data->timeline, &DecideWhatToDo, TM_AddToArgs(NULL, 1, data), "decidewhattodo");
-				} else {
+	// percentage of the symbol drawn on, checked at its precomputed samples
+	ResetCoverage(&data->stroke_coverage, field);
+	for (int i = 0; i < data->stroke_count; i++) {
+		AddCoverageSegment(&data->stroke_coverage, field, &data->stroke[i]);
+	}
+	data->distance2 = field->sample_count ? (data->stroke_coverage.sum / field->sample_count) : 0;
+}
 
-					    TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-							             al_load_audio_stream(GetDataFilePath(game, "voices/player-03.flac"), 4, 1024),
-							             "HRMPF!!!", true), "speak");
+void ResetMeter(struct GamestateResources *data) {
+	data->meter_segments = 0;
+	data->meter_inside = 0;
+	data->meter_drawn = 0;
+	data->meter_hits = 0;
+	data->meter_sum = 0;
+	data->meter_total = 0;
+	data->meter_time = 0;
+	data->meter_peak = 0;
+	data->meter_frames = 0;
+	for (int y = 0; y < data->meter_height; y++) {
+		for (int x = 0; x < data->meter_width; x++) {
+			bool inside = data->drawfield && (SampleDistanceField(data->drawfield, (x + 0.5) * METER_CELL, (y + 0.5) * METER_CELL) <= 0);
+			data->meter_grid[y * data->meter_width + x] = inside ? METER_INSIDE : 0;
+			data->meter_inside += inside;
+		}
+	}
+	if (data->distance_scoring && data->drawfield) {
+		ResetCoverage(&data->meter_coverage, data->drawfield);
+	}
+}
 
-							TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-							             al_load_audio_stream(GetDataFilePath(game, "voices/greg-04.flac"), 4, 1024),
-							             "Oh, sorry, did I take it too aggressively? I'm so bad at this... Let's try again.", false), "speak");
+void MarkMeterCells(struct GamestateResources *data, struct StrokeSegment *seg) {
+	int x1 = fmax(0, (fmin(seg->x1, seg->x2) - STROKE_RADIUS) / METER_CELL);
+	int y1 = fmax(0, (fmin(seg->y1, seg->y2) - STROKE_RADIUS) / METER_CELL);
+	int x2 = fmin(data->meter_width - 1, (fmax(seg->x1, seg->x2) + STROKE_RADIUS) / METER_CELL);
+	int y2 = fmin(data->meter_height - 1, (fmax(seg->y1, seg->y2) + STROKE_RADIUS) / METER_CELL);
+	for (int y = y1; y <= y2; y++) {
+		for (int x = x1; x <= x2; x++) {
+			unsigned char *cell = &data->meter_grid[y * data->meter_width + x];
+			if ((*cell & METER_DRAWN) ||
+			    (DistanceToSegment((x + 0.5) * METER_CELL, (y + 0.5) * METER_CELL, seg->x1, seg->y1, seg->x2, seg->y2) > STROKE_RADIUS)) {
+				continue;
+			}
+			*cell |= METER_DRAWN;
+			data->meter_drawn++;
+			if (*cell & METER_INSIDE) {
+				data->meter_hits++;
+			}
+		}
+	}
+}
 
-							// TODO: *sigh* Okay. Once again.
+void UpdateMeter(struct GamestateResources *data) {
+	// Takes in the segments drawn since the last frame. Should drawing outrun the budget, the rest is left
+	// for the next frame; the meter lags a bit, but the frame doesn't. Whatever this frame's earlier logic
+	// ticks took counts against it too, and a quarter is left for drawing the bars.
+	double start = al_get_time();
+	while ((data->meter_segments < data->stroke_count) && (data->meter_time + al_get_time() - start < METER_BUDGET * 0.75)) {
+		struct StrokeSegment *seg = &data->stroke[data->meter_segments++];
+		if (!data->distance_scoring) {
+			MarkMeterCells(data, seg);
+		} else if (data->drawfield) {
+			AddAccuracySegment(data->drawfield, seg, &data->meter_sum, &data->meter_total);
+			AddCoverageSegment(&data->meter_coverage, data->drawfield, seg);
+		}
+	}
+	data->meter_time += al_get_time() - start;
+}
 
-							TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-							             al_load_audio_stream(GetDataFilePath(game, "voices/greg-02.flac"), 4, 1024),
-							             "So... uhmm... My name is Greg. What's yours?", false), "speak");
+void GetMeterScores(struct GamestateResources *data, float scores[2]) {
+	// estimates of whichever scores decide the round, so they can be held against the same thresholds
+	if (data->distance_scoring) {
+		struct DistanceField *field = data->drawfield;
+		scores[0] = data->meter_total ? data->meter_sum / data->meter_total : 0;
+		scores[1] = (field && field->sample_count) ? data->meter_coverage.sum / field->sample_count : 0;
+		return;
+	}
+	scores[0] = data->meter_drawn ? data->meter_hits / (float)data->meter_drawn : 0;
+	scores[1] = data->meter_inside ? data->meter_hits / (float)data->meter_inside : 0;
+}
 
-							TM_AddAction(data->timeline, &Draw, TM_AddToArgs(NULL, 2, data, data->sn), "draw");
-				}
-			}
+// Gamestate_Draw goes through these instead of Allegro directly, so that what it submits and how often it
+// switches the target, the blender or the shader is counted in one place.
 
+void CountDraw(struct GamestateResources *data) {
+	// draws made while bitmap drawing is held go out together once it's released
+	if (data->holding) {
+		data->held++;
+	} else {
+		data->draw_calls++;
+	}
+}
 
+void HoldDrawing(struct GamestateResources *data, bool hold) {
+	al_hold_bitmap_drawing(hold);
+	data->holding = hold;
+	if (!hold && data->held) {
+		data->draw_calls++;
+		data->held = 0;
+	}
+}
 
-			else if (data->stage == 2) {
+void SetTarget(struct GamestateResources *data, ALLEGRO_BITMAP *bitmap) {
+	if (al_get_target_bitmap() != bitmap) {
+		al_set_target_bitmap(bitmap);
+		data->state_changes++;
+	}
+}
 
-				won = (data->score1 > 0.8) && (data->score2 > 0.35);
-				if (data->cheat) {
-					won = true;
-					data->cheat = false;
-				}
+void SetBlender(struct GamestateResources *data, int op, int src, int dst) {
+	int current_op, current_src, current_dst;
+	al_get_blender(&current_op, &current_src, &current_dst);
+	if ((op != current_op) || (src != current_src) || (dst != current_dst)) {
+		al_set_blender(op, src, dst);
+		data->state_changes++;
+	}
+}
 
-				if (won) {
-					TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-					             al_load_audio_stream(GetDataFilePath(game, "voices/player-12.flac"), 4, 1024),
-					             "Strawberries!!!", true), "speak");
-					if (data->facts.crocodile) {
-						TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-						             al_load_audio_stream(GetDataFilePath(game, "voices/greg-12.flac"), 4, 1024),
-						             "You sure do have a thing for strawberries, huh?", false), "speak");
-					} else {
-						TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-						             al_load_audio_stream(GetDataFilePath(game, "voices/greg-11.flac"), 4, 1024),
-						             "Oh, that's cool! I like them too.", false), "speak");
+void UseShader(struct GamestateResources *data, ALLEGRO_SHADER *shader) {
+	al_use_shader(shader);
+	data->state_changes++;
+}
 
-					}
-					data->stage++;
-					TM_AddAction(data->timeline, &DecideWhatToDo, TM_AddToArgs(NULL, 1, data), "decidewhattodo");
-				} else {
+void ClearTarget(struct GamestateResources *data, ALLEGRO_COLOR color) {
+	al_clear_to_color(color);
+	CountDraw(data);
+}
 
-					    TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-							             al_load_audio_stream(GetDataFilePath(game, "voices/player-11.flac"), 4, 1024),
-							             "Um, hrmpf, no.", true), "speak");
+void SubmitBitmap(struct GamestateResources *data, ALLEGRO_BITMAP *bitmap, ALLEGRO_COLOR tint, float x, float y, float w, float h) {
+	// the whole bitmap, scaled to the given rectangle
+	al_draw_tinted_scaled_bitmap(bitmap, tint, 0, 0, al_get_bitmap_width(bitmap), al_get_bitmap_height(bitmap), x, y, w, h, 0);
+	CountDraw(data);
+}
 
-							TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-							             al_load_audio_stream(GetDataFilePath(game, "voices/greg-04.flac"), 4, 1024),
-							             "Oh, sorry, did I take it too aggressively? I'm so bad at this... Let's try again.", false), "speak");
+void SubmitCharacter(struct Game *game, struct GamestateResources *data, struct Character *character, float scale_x, float scale_y) {
+	DrawScaledCharacter(game, character, al_map_rgb(255,255,255), scale_x, scale_y, 0);
+	CountDraw(data);
+}
 
-							// TODO: *sigh* Okay. Once again.
-	data->stage--;
-	            TM_AddAction(data->timeline, &DecideWhatToDo, TM_AddToArgs(NULL, 1, data), "decidewhattodo");
-				}
-			}
+void SubmitText(struct GamestateResources *data, ALLEGRO_FONT *font, ALLEGRO_COLOR color, float x, float y, char const *text) {
+	al_draw_text(font, color, x, y, ALLEGRO_ALIGN_CENTER, text);
+	CountDraw(data);
+}
 
+int WrappedTextWithShadow(struct Game *game, ALLEGRO_FONT *font, ALLEGRO_COLOR color, float x, float y, int width, int flags, char const *text);
 
+void SubmitWrappedText(struct Game *game, struct GamestateResources *data, float y, char const *text) {
+	// a line per draw, so held, or it's more than one
+	WrappedTextWithShadow(game, data->smallfont, al_map_rgba_f(1,1,1,1), game->viewport.width * 0.05, y, game->viewport.width * 0.9, ALLEGRO_ALIGN_CENTER, text);
+	CountDraw(data);
+}
 
-			else if (data->stage == 3) {
+void SubmitRectangle(struct GamestateResources *data, float x1, float y1, float x2, float y2, ALLEGRO_COLOR color) {
+	al_draw_filled_rectangle(x1, y1, x2, y2, color);
+	CountDraw(data);
+}
 
-				won = (data->score1 > 0.85) && (data->score2 > 0.45);
-				if (data->cheat) {
-					won = true;
-					data->cheat = false;
-				}
+void SubmitRoundedRectangle(struct GamestateResources *data, float x1, float y1, float x2, float y2, float rx, float ry, ALLEGRO_COLOR color) {
+	al_draw_filled_rounded_rectangle(x1, y1, x2, y2, rx, ry, color);
+	CountDraw(data);
+}
 
-				if (won) {
+void SubmitLine(struct GamestateResources *data, float x1, float y1, float x2, float y2, ALLEGRO_COLOR color, float thickness) {
+	al_draw_line(x1, y1, x2, y2, color, thickness);
+	CountDraw(data);
+}
 
-					if (!data->facts.bitten) {
-					TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-					             al_load_audio_stream(GetDataFilePath(game, "voices/player-14.flac"), 4, 1024),
-					             "Well, okay... When I was little, I got bitten by a warthog. I've been afraid of them ever since.", true), "speak");
+void AddRectangle(struct RectangleBatch *batch, float x1, float y1, float x2, float y2, ALLEGRO_COLOR color) {
+	if (batch->count + 6 > BATCH_RECTANGLES * 6) {
+		return;
+	}
+	float x[6] = { x1, x2, x2, x1, x2, x1 }, y[6] = { y1, y1, y2, y1, y2, y2 };
+	for (int i = 0; i < 6; i++) {
+		batch->v[batch->count++] = (ALLEGRO_VERTEX){ .x = x[i], .y = y[i], .z = 0, .color = color };
+	}
+}
 
-					TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-					             al_load_audio_stream(GetDataFilePath(game, "voices/player-15.flac"), 4, 1024),
-					             "Uff. There it is. My biggest secret.", true), "speak");
-					data->facts.bitten = true;
-					} else {
-						TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-						             al_load_audio_stream(GetDataFilePath(game, "voices/player-16.flac"), 4, 1024),
-						             "I think the thing with... you know, warthogs. That was it.", true), "speak");
+void DrawRectangles(struct GamestateResources *data, struct RectangleBatch *batch) {
+	if (batch->count) {
+		al_draw_prim(batch->v, NULL, NULL, 0, batch->count, ALLEGRO_PRIM_TRIANGLE_LIST);
+		CountDraw(data);
+	}
+	batch->count = 0;
+}
 
-					}
+void DrawMeter(struct Game *game, struct GamestateResources *data, struct RectangleBatch *batch) {
+	// two bars over the right end of the timer: accuracy on top of coverage, with the stage's thresholds marked
+	double start = al_get_time();
+	float values[2];
+	GetMeterScores(data, values);
+	struct DialogueStage *stage = GetDialogueStage(data->dialogue, data->stage);
+	float thresholds[2] = { stage ? stage->score1 : 0, stage ? stage->score2 : 0 };
+	float w = game->viewport.width * 0.2, h = game->viewport.height * 0.01;
+	float x = game->viewport.width * 0.78;
+	for (int i = 0; i < 2; i++) {
+		float y = game->viewport.height * (0.945 + i * 0.015);
+		bool passing = values[i] > thresholds[i];
+		AddRectangle(batch, x, y, x + w, y + h, al_map_rgba(0, 0, 0, 127));
+		AddRectangle(batch, x, y, x + w * values[i], y + h, passing ? al_map_rgb(160, 255, 160) : al_map_rgb(255, 255, 255));
+		AddRectangle(batch, x + w * thresholds[i] - 1, y - 1, x + w * thresholds[i] + 1, y + h + 1, al_map_rgb(255, 64, 64));
+	}
 
-					TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-					             al_load_audio_stream(GetDataFilePath(game, "voices/greg-19.flac"), 4, 1024),
-					             "That's okay. I'm proud of you, that was really brave.", false), "speak");
+	double time = al_get_time() - start + data->meter_time;
+	data->meter_time = 0;
+	data->meter_frames++;
+	if (time > data->meter_peak) {
+		data->meter_peak = time;
+	}
+}
 
+uint32_t AutoplayRandom(struct GamestateResources *data) {
+	// xorshift, so that a seed plays out the same way everywhere
+	data->autoplay_rng ^= data->autoplay_rng << 13;
+	data->autoplay_rng ^= data->autoplay_rng >> 17;
+	data->autoplay_rng ^= data->autoplay_rng << 5;
+	return data->autoplay_rng;
+}
 
-					TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-					             al_load_audio_stream(GetDataFilePath(game, "voices/greg-21.flac"), 4, 1024),
-					             "You know, at first I was a bit afraid that we wouldn’t click, but I think I warmed up to you.", false), "speak");
-					TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-					             al_load_audio_stream(GetDataFilePath(game, "voices/greg-22.flac"), 4, 1024),
-					             "There is just something you should know about me...", false), "speak");
-					TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-					             al_load_audio_stream(GetDataFilePath(game, "voices/greg-23.flac"), 4, 1024),
-					             "But I worry that it will make you hate me.", false), "speak");
+void AutoplayStroke(struct GamestateResources *data) {
+	// Strokes over the symbol's own samples a few rows at a time, joining the neighbouring ones into a single
+	// segment. A drawing that's meant to fail stops after a part of the symbol.
+	struct DistanceField *field = data->drawfield;
+	int count = data->autoplay_pass ? field->sample_count : field->sample_count * AUTOPLAY_FAIL_PART;
+	for (int runs = 0; (runs < AUTOPLAY_RUNS) && (data->autoplay_sample < count); runs++) {
+		int last = data->autoplay_sample;
+		float y = field->samples[last * 2 + 1];
+		while ((last + 1 < count) && (field->samples[(last + 1) * 2 + 1] == y) &&
+		       (field->samples[(last + 1) * 2] - field->samples[last * 2] <= field->scale * 2)) {
+			last++;
+		}
+		data->x = field->samples[data->autoplay_sample * 2];
+		data->y = y;
+		DrawStrokeSegment(data, field->samples[last * 2], y);
+		data->autoplay_sample = last + 1;
+	}
+	if ((data->autoplay_sample >= count) && (data->timeleft > 1)) {
+		data->timeleft = 1; // done, no need to wait for the clock
+	}
+}
 
-					TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-					             al_load_audio_stream(GetDataFilePath(game, "voices/player-17.flac"), 4, 1024),
-					             "You don’t really like strawberries, do you?", true), "speak");
+void ScoreWork(void *arg) {
+	// The stroke is left alone until the next drawing, so it can be read from a worker.
+	struct GamestateResources *data = arg;
+	double time = al_get_time();
+	CalculateDistanceScore(data);
+	data->score_time = al_get_time() - time;
+}
 
-					TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-					             al_load_audio_stream(GetDataFilePath(game, "voices/greg-24.flac"), 4, 1024),
-					             "No, that's not it.", false), "speak");
+void ScoreDone(struct Game *game, void *arg) {
+	struct GamestateResources *data = arg;
+	data->scored = true;
+}
 
-					TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-					             al_load_audio_stream(GetDataFilePath(game, "voices/player-18.flac"), 4, 1024),
-					             "Is it connected to the fact that you’re all furry?", true), "speak");
+bool Draw(struct Game *game, struct TM_Action *action, enum TM_ActionState state) {
+	struct Cue *cue = TM_GetArg(action->arguments, 0);
+	struct GamestateResources *data = cue->data;
 
+	if (state == TM_ACTIONSTATE_START) {
+		RequireResident(game, &data->residents[cue->symbol]);
+		ALLEGRO_BITMAP *bmp = data->symbols[cue->symbol];
+		data->drawfield = data->fields[cue->symbol];
+		data->stroke_count = 0;
+		ResetMeter(data);
+		ResetPrediction(&data->prediction);
+		data->drawing = true;
+		data->time = 60*6;
+		data->timeleft = data->time;
+		data->button = false;
+		data->drawbmp = bmp;
+		data->score1 = 0;
+		data->score2 = 0;
+		data->scoring = false;
+		data->scored = false;
+		if (data->autoplay) {
+			data->autoplay_pass = (AutoplayRandom(data) % 100) < AUTOPLAY_PASS_CHANCE;
+			data->autoplay_sample = 0;
+		}
 
-					TM_AddAction(data->timeline, &NextStage, TM_AddToArgs(NULL, 1, data), "nextstage");
+		ALLEGRO_BITMAP *target = al_get_target_bitmap();
+		al_set_target_bitmap(data->canvas);
+		al_clear_to_color(al_map_rgba(0, 0, 0, 0));
+		al_set_target_bitmap(target);
 
-					TM_AddAction(data->timeline, &DecideWhatToDo, TM_AddToArgs(NULL, 1, data), "decidewhattodo");
-				} else {
+		if (game->display) {
+			al_hide_mouse_cursor(game->display);
+		}
+	}
 
-					    TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-							             al_load_audio_stream(GetDataFilePath(game, "voices/player-13.flac"), 4, 1024),
-							             "I... was. Born. ... Too. Eh. ", true), "speak");
+	if (state == TM_ACTIONSTATE_RUNNING) {
+		if (!data->drawing) {
 
-							TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-							             al_load_audio_stream(GetDataFilePath(game, "voices/greg-20.flac"), 4, 1024),
-							             "Hmm, are you joking? I'm really trying my best here to open up and you are just mocking me.", false), "speak");
+			// points counting
 
-							TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-							             al_load_audio_stream(GetDataFilePath(game, "voices/greg-05.flac"), 4, 1024),
-							             "*sigh* Okay. Once again.", false), "speak");
-	data->stage--;
-	            TM_AddAction(data->timeline, &DecideWhatToDo, TM_AddToArgs(NULL, 1, data), "decidewhattodo");
+			if (!data->scoring) {
+				if (game->display && !game->config.fullscreen) {
+					al_show_mouse_cursor(game->display);
 				}
+				data->scoring = true;
+				SubmitJob(game->data->jobs, ScoreWork, ScoreDone, data);
+				return false;
+			}
+			if (!data->scored) {
+				return false;
 			}
 
+			PrintConsole(game, "distance: %f%%, %f%% (%d segments, %.0f us)", data->distance1 * 100, data->distance2 * 100,
+			             data->stroke_count, data->score_time * 1000000);
+			float meter[2];
+			GetMeterScores(data, meter);
+			PrintConsole(game, "meter: %f%%, %f%% (peak %.0f us per frame over %d frames)", meter[0] * 100, meter[1] * 100,
+			             data->meter_peak * 1000000, data->meter_frames);
+			if (data->meter_peak > METER_BUDGET) {
+				PrintConsole(game, "The meter went over its budget of %.0f us per frame!", METER_BUDGET * 1000000);
+			}
 
-			else if (data->stage == 4) {
+			if (!data->distance_scoring || game->config.debug) {
+				// reading the canvas back stalls the GPU, but it's what the thresholds were tuned for
+				double time = al_get_time();
+				CalculateScore(game, data);
+				PrintConsole(game, "score1: %f%%, score2: %f%% (raster, %.0f us)", data->score1 * 100, data->score2 * 100,
+				             (al_get_time() - time) * 1000000);
+			}
 
-				won = (data->score1 > 0.9) && (data->score2 > 0.5);
+			struct DialogueStage *stage = GetDialogueStage(data->dialogue, data->stage);
+			if (stage) {
+				float score1 = data->distance_scoring ? data->distance1 : data->score1;
+				float score2 = data->distance_scoring ? data->distance2 : data->score2;
+				bool won = (score1 > stage->score1) && (score2 > stage->score2);
 				if (data->cheat) {
 					won = true;
 					data->cheat = false;
 				}
-
-				if (won) {
-					TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-					             al_load_audio_stream(GetDataFilePath(game, "voices/player-19.flac"), 4, 1024),
-					             "Oh... oh! Um... I guess that's okay!", true), "speak");
-					TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-					             al_load_audio_stream(GetDataFilePath(game, "voices/player-20.flac"), 4, 1024),
-					             "You're... nice! I'm sorry, I've been wrong about warthogs all this time.", true), "speak");
-					TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-					             al_load_audio_stream(GetDataFilePath(game, "voices/player-21.flac"), 4, 1024),
-					             "Would you maybe... want to spend more time... with me?", true), "speak");
-					TM_AddAction(data->timeline, &NextStage, TM_AddToArgs(NULL, 1, data), "nextstage");
-
-					TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-					             al_load_audio_stream(GetDataFilePath(game, "voices/greg-26.flac"), 4, 1024),
-					             "Oh, really? Absolutely!", false), "speak");
-
-					TM_AddAction(data->timeline, &End, TM_AddToArgs(NULL, 1, data), "end");
-					TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-					             al_load_audio_stream(GetDataFilePath(game, "voices/love.flac"), 4, 1024),
-					             NULL, false), "speak");
-
-				} else {
-					TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-					             al_load_audio_stream(GetDataFilePath(game, "voices/player-01.flac"), 4, 1024),
-					             "Uhm...", true), "speak");
-
-					TM_AddAction(data->timeline, &Draw, TM_AddToArgs(NULL, 2, data, data->sheart), "draw");
-
+				if (data->autoplay) {
+					if (won) {
+						data->autoplay_passed++;
+					} else {
+						data->autoplay_failed++;
+					}
+					if (won != data->autoplay_pass) {
+						data->autoplay_mismatches++;
+						PrintConsole(game, "Autoplay: the drawing was meant to %s, but it %s!", data->autoplay_pass ? "pass" : "fail", won ? "passed" : "failed");
+					}
 				}
+				RunDialogue(game, data, won ? DIALOGUE_NODE_WON : DIALOGUE_NODE_LOST);
 			}
 			return true;
 		}
@@ -413,6 +1514,10 @@ bool Draw(struct Game *game, struct TM_Action *action, enum TM_ActionState state
 
 	}
 
+	if (state == TM_ACTIONSTATE_DESTROY) {
+		PoolFree(data->cues, cue);
+		data->actions--;
+	}
 
 	return false;
 }
@@ -426,121 +1531,19 @@ bool DecideWhatToDo(struct Game *game, struct TM_Action *action, enum TM_ActionS
 	struct GamestateResources *data = TM_GetArg(action->arguments, 0);
 
 	if (state == TM_ACTIONSTATE_START) {
-		if (data->stage == 1) {
-
-			if (data->facts.name) {
-				TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-				             al_load_audio_stream(GetDataFilePath(game, "voices/greg-03.flac"), 4, 1024),
-				             "Uhm, sorry, but I forgot your name. Could you tell me again?", false), "speak");
-			} else {
-				TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-				             al_load_audio_stream(GetDataFilePath(game, "voices/greg-01.flac"), 4, 1024),
-				             "Uhm... hello... Nice to meet you...", false), "speak");
-				TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-				             al_load_audio_stream(GetDataFilePath(game, "voices/player-02.flac"), 4, 1024),
-				             "Hrmpf", true), "speak");
-				TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-				             al_load_audio_stream(GetDataFilePath(game, "voices/greg-02.flac"), 4, 1024),
-				             "So... uhmm... My name is Greg. What's yours?", false), "speak");
-			}
-			data->facts.name = true;
-			TM_AddAction(data->timeline, &Draw, TM_AddToArgs(NULL, 2, data, data->sn), "draw");
-
-//			TM_AddAction(data->timeline, &DecideWhatToDo, TM_AddToArgs(NULL, 1, data), "decidewhattodo");
-
-		}
-
-		if (data->stage == 2) {
-			if (!data->facts.weakness) {
-				TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-				             al_load_audio_stream(GetDataFilePath(game, "voices/greg-06.flac"), 4, 1024),
-				             "Hi Nolan! ... Ok. You don't seem to use a lot of words...", false), "speak");
-
-				TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-				             al_load_audio_stream(GetDataFilePath(game, "voices/player-05.flac"), 4, 1024),
-				             "Hrmpf.", true), "speak");
-
-				TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-				             al_load_audio_stream(GetDataFilePath(game, "voices/greg-07.flac"), 4, 1024),
-				             "I must admit that I have a weakness for people who just know what they want.", false), "speak");
-
-				TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-				             al_load_audio_stream(GetDataFilePath(game, "voices/greg-08.flac"), 4, 1024),
-				             "So... maybe let's get to know each other!", false), "speak");
-
-				TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-				             al_load_audio_stream(GetDataFilePath(game, "voices/player-10.flac"), 4, 1024),
-				             "Hrmpf, ok...", true), "speak");
-
-				TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-				             al_load_audio_stream(GetDataFilePath(game, "voices/greg-09.flac"), 4, 1024),
-				             "I told you about one of my weaknesses. Do *you* have any?", false), "speak");
-			} else {
-				TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-				             al_load_audio_stream(GetDataFilePath(game, "voices/greg-10.flac"), 4, 1024),
-				             "So, what was it about your weakness again?", false), "speak");
-
-			}
-			data->facts.weakness = true;
-			TM_AddAction(data->timeline, &Draw, TM_AddToArgs(NULL, 2, data, data->sberry), "draw");
-
-
-		}
-
-
-
-		if (data->stage == 3) {
-			if (!data->facts.crocodile) {
-				TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-				             al_load_audio_stream(GetDataFilePath(game, "voices/greg-13.flac"), 4, 1024),
-				             "You know, you seem like a very nice... um, person. I'd really like to share something with you.", false), "speak");
-
-
-				TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-				             al_load_audio_stream(GetDataFilePath(game, "voices/greg-14.flac"), 4, 1024),
-				             "Okay... There it goes... I'm... I'm afraid of crocodiles.", false), "speak");
-
-				TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-				             al_load_audio_stream(GetDataFilePath(game, "voices/greg-15.flac"), 4, 1024),
-				             "They just have this really weird look. Like they are making fun of me.", false), "speak");
-
-				TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-				             al_load_audio_stream(GetDataFilePath(game, "voices/greg-16.flac"), 4, 1024),
-				             "And I never know if they just want to eat me or if they are laughing.", false), "speak");
-
-				TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-				             al_load_audio_stream(GetDataFilePath(game, "voices/greg-17.flac"), 4, 1024),
-				             "Please don't tell anyone.", false), "speak");
-			}
-			  TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-				             al_load_audio_stream(GetDataFilePath(game, "voices/greg-18.flac"), 4, 1024),
-				             "Would you like to share something with me?", false), "speak");
-
-			data->facts.crocodile = true;
-			TM_AddAction(data->timeline, &Draw, TM_AddToArgs(NULL, 2, data, data->swarthog), "draw");
-
-		}
-
-		if (data->stage == 4) {
-
-
-			TM_AddAction(data->timeline, &Speak, TM_AddToArgs(NULL, 4, data,
-			             al_load_audio_stream(GetDataFilePath(game, "voices/greg-25.flac"), 4, 1024),
-			             "Yes, kind of... so... it’s just that I'm a warthog.", false), "speak");
-
-			TM_AddAction(data->timeline, &Draw, TM_AddToArgs(NULL, 2, data, data->sheart), "draw");
-
-
-		}
-
-
+		// no pool reset here, as lines after the decision in the node may still hold their cues;
+		// each cue goes back on its action's destruction and the stats are printed on unload
+		RunDialogue(game, data, DIALOGUE_NODE_INTRO);
+	}
 
+	if (state == TM_ACTIONSTATE_DESTROY) {
+		data->actions--;
 	}
 
 	return true;
 }
 
-int Gamestate_ProgressCount = 9; // number of loading steps as reported by Gamestate_Load
+int Gamestate_ProgressCount = LOAD_TARGETS + 1; // number of loading steps as reported by Gamestate_Load: setup + one per target
 
 void SwitchSpritesheet(struct Game *game, struct Character *character, char *name) {
 	struct Spritesheet *tmp = character->spritesheets;
@@ -567,8 +1570,38 @@ void SwitchSpritesheet(struct Game *game, struct Character *character, char *nam
 	return;
 }
 
-void Gamestate_Logic(struct Game *game, struct GamestateResources* data) {
-	// Called 60 times per second. Here you should do all your game logic.
+void Gamestate_Start(struct Game *game, struct GamestateResources* data);
+
+void ReportAutoplay(struct Game *game, struct GamestateResources *data) {
+	// What a long-running kiosk would be leaking, if anything; these should stay flat from run to run.
+	PrintConsole(game, "Autoplay run %d: %d drawings passed, %d failed, %d not as meant to", data->autoplay_runs,
+	             data->autoplay_passed, data->autoplay_failed, data->autoplay_mismatches);
+	PrintConsole(game, "Autoplay run %d: %d streams, %d bitmaps, %d timeline actions, %d cues in use", data->autoplay_runs,
+	             CountAssets(game, NULL, "stream"), CountAssets(game, NULL, "bitmap"), data->actions, data->cues->used);
+	ReportAssets(game, "date");
+}
+
+void Autoplay(struct Game *game, struct GamestateResources *data) {
+	// Stands in for the player: starts the date, draws when asked to and starts over once it has ended.
+	if (data->stage == 0) {
+		QueueAction(data, &DecideWhatToDo, data, "start");
+		data->stage++;
+		return;
+	}
+	if (data->drawing && data->drawfield) {
+		AutoplayStroke(data);
+	}
+	if (data->end && (++data->autoplay_ticks >= AUTOPLAY_END_TICKS)) {
+		data->autoplay_runs++;
+		ReportAutoplay(game, data);
+		Gamestate_Start(game, data);
+	}
+}
+
+void Step(struct Game *game, struct GamestateResources* data) {
+	if (data->autoplay) {
+		Autoplay(game, data);
+	}
 	TM_Process(data->timeline);
 
 if (data->end) {
@@ -590,6 +1623,7 @@ if (data->end) {
 	}
 	if (data->drawing) {
 		data->timeleft--;
+		UpdateMeter(data);
 	}
 	if (data->timeleft==0) {
 		data->drawing = false;
@@ -598,37 +1632,61 @@ if (data->end) {
 
 	AnimateCharacter(game, data->fire, 1);
 	AnimateCharacter(game, data->warthog, 1);
+
+	UpdateResidency(game, data);
+}
+
+void Gamestate_Logic(struct Game *game, struct GamestateResources* data) {
+	// Called 60 times per second. Here you should do all your game logic.
+	for (int i = 0; i < (data->autoplay ? data->autoplay_speed : 1); i++) {
+		Step(game, data);
+	}
+	WarmGlyphs(game, data, &data->font_target);
+	WarmGlyphs(game, data, &data->smallfont_target);
 }
 
 void Gamestate_Draw(struct Game *game, struct GamestateResources* data) {
 	// Called as soon as possible, but no sooner than next Gamestate_Logic call.
 	// Draw everything to the screen here.
+	LATENCY_FRAME(al_get_time());
+	if (!data->interactive) {
+		PrintConsole(game, "Date interactive %f s after load started", al_get_time() - data->load_start);
+		TRACE_INSTANT("date: interactive");
+		data->interactive = true;
+	}
+
+	data->draw_calls = 0;
+	data->state_changes = 0;
 
-	al_draw_scaled_bitmap(data->bg, 0, 0, al_get_bitmap_width(data->bg), al_get_bitmap_height(data->bg), 0, 0, game->viewport.width, game->viewport.height, 0);
+	// usually the backbuffer, but the render benchmark draws into a memory bitmap instead
+	ALLEGRO_BITMAP *target = al_get_target_bitmap();
+
+	data->scaledbg = PrescaleToViewport(game, "date", "bg.png (scaled)", data->scaledbg, data->bg);
+	SubmitBitmap(data, data->scaledbg, al_map_rgb(255,255,255), 0, 0, al_get_bitmap_width(data->scaledbg), al_get_bitmap_height(data->scaledbg));
 
 	SwitchSpritesheet(game, data->table, "1");
 
-	int scale = 1;
+	int scale = game->data->quality.sprite_scale; // sprites are downscaled by that much when loaded
 #ifdef ALLEGRO_ANDROID
-	scale = 2;
+	scale *= 2;
 #endif
 	if ((data->stage < 5) && (data->stage)) {
 		SwitchSpritesheet(game, data->warthog, "1");
-		DrawScaledCharacter(game, data->warthog, al_map_rgb(255,255,255), scale * game->viewport.width / (float)3840, scale * game->viewport.height / (float)2160, 0);
+		SubmitCharacter(game, data, data->warthog, scale * game->viewport.width / (float)3840, scale * game->viewport.height / (float)2160);
 	}
-	DrawScaledCharacter(game, data->table, al_map_rgb(255,255,255), scale * game->viewport.width / (float)3840, scale * game->viewport.height / (float)2160, 0);
+	SubmitCharacter(game, data, data->table, scale * game->viewport.width / (float)3840, scale * game->viewport.height / (float)2160);
 
 	if (data->stage >= 1) {
-		al_set_target_bitmap(data->tmp);
-		al_clear_to_color(al_map_rgba(0,0,0,0));
+		SetTarget(data, data->tmp);
+		ClearTarget(data, al_map_rgba(0,0,0,0));
 
 		SwitchSpritesheet(game, data->table, "2");
 //		if (data->stage < 5) {
 		  SwitchSpritesheet(game, data->warthog, "2");
-			DrawScaledCharacter(game, data->warthog, al_map_rgb(255,255,255), scale * game->viewport.width / (float)3840, scale * game->viewport.height / (float)2160, 0);
+			SubmitCharacter(game, data, data->warthog, scale * game->viewport.width / (float)3840, scale * game->viewport.height / (float)2160);
 //		}
-		DrawScaledCharacter(game, data->table, al_map_rgb(255,255,255), scale * game->viewport.width / (float)3840, scale * game->viewport.height / (float)2160, 0);
-		al_set_blender(ALLEGRO_ADD, ALLEGRO_ZERO, ALLEGRO_ALPHA); // now as a mask
+		SubmitCharacter(game, data, data->table, scale * game->viewport.width / (float)3840, scale * game->viewport.height / (float)2160);
+		SetBlender(data, ALLEGRO_ADD, ALLEGRO_ZERO, ALLEGRO_ALPHA); // now as a mask
 
 		ALLEGRO_BITMAP *bmp = data->light3;
 		if (data->stage == 1) {
@@ -641,16 +1699,16 @@ void Gamestate_Draw(struct Game *game, struct GamestateResources* data) {
 			bmp = data->light4;
 		}
 
-		al_draw_scaled_bitmap(bmp, 0, 0, al_get_bitmap_width(data->light1), al_get_bitmap_height(data->light1), 0, 0, game->viewport.width, game->viewport.height, 0);
-		al_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_INVERSE_ALPHA);
+		SubmitBitmap(data, bmp, al_map_rgb(255,255,255), 0, 0, game->viewport.width, game->viewport.height);
+		SetBlender(data, ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_INVERSE_ALPHA);
 
-		al_set_target_backbuffer(game->display);
-		al_draw_tinted_bitmap(data->tmp, al_map_rgba_f(data->rand, data->rand, data->rand, data->rand), 0, 0,  0);
+		SetTarget(data, target);
+		SubmitBitmap(data, data->tmp, al_map_rgba_f(data->rand, data->rand, data->rand, data->rand), 0, 0, al_get_bitmap_width(data->tmp), al_get_bitmap_height(data->tmp));
 	}
 
 	if (data->stage >= 2) {
-		al_set_target_bitmap(data->tmp);
-		al_clear_to_color(al_map_rgba(0,0,0,0));
+		SetTarget(data, data->tmp);
+		ClearTarget(data, al_map_rgba(0,0,0,0));
 
 		SwitchSpritesheet(game, data->table, "3");
 		if (data->stage < 5) {
@@ -658,9 +1716,9 @@ void Gamestate_Draw(struct Game *game, struct GamestateResources* data) {
 		} else {
 			SwitchSpritesheet(game, data->warthog, "happy");
 		}
-		DrawScaledCharacter(game, data->warthog, al_map_rgb(255,255,255), scale * game->viewport.width / (float)3840, scale * game->viewport.height / (float)2160, 0);
-		DrawScaledCharacter(game, data->table, al_map_rgb(255,255,255), scale * game->viewport.width / (float)3840, scale * game->viewport.height / (float)2160, 0);
-		al_set_blender(ALLEGRO_ADD, ALLEGRO_ZERO, ALLEGRO_ALPHA); // now as a mask
+		SubmitCharacter(game, data, data->warthog, scale * game->viewport.width / (float)3840, scale * game->viewport.height / (float)2160);
+		SubmitCharacter(game, data, data->table, scale * game->viewport.width / (float)3840, scale * game->viewport.height / (float)2160);
+		SetBlender(data, ALLEGRO_ADD, ALLEGRO_ZERO, ALLEGRO_ALPHA); // now as a mask
 
 		ALLEGRO_BITMAP *bmp = data->light3;
 		if (data->stage == 2) {
@@ -673,11 +1731,11 @@ void Gamestate_Draw(struct Game *game, struct GamestateResources* data) {
 			bmp = data->light4;
 		}
 
-		al_draw_scaled_bitmap(bmp, 0, 0, al_get_bitmap_width(data->light1), al_get_bitmap_height(data->light1), 0, 0, game->viewport.width, game->viewport.height, 0);
-		al_set_blender(ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_INVERSE_ALPHA);
+		SubmitBitmap(data, bmp, al_map_rgb(255,255,255), 0, 0, game->viewport.width, game->viewport.height);
+		SetBlender(data, ALLEGRO_ADD, ALLEGRO_ONE, ALLEGRO_INVERSE_ALPHA);
 
-		al_set_target_backbuffer(game->display);
-		al_draw_tinted_bitmap(data->tmp, al_map_rgba_f(data->rand, data->rand, data->rand, data->rand), 0, 0,  0);
+		SetTarget(data, target);
+		SubmitBitmap(data, data->tmp, al_map_rgba_f(data->rand, data->rand, data->rand, data->rand), 0, 0, al_get_bitmap_width(data->tmp), al_get_bitmap_height(data->tmp));
 	}
 
 	SwitchSpritesheet(game, data->table, "1");
@@ -686,19 +1744,21 @@ void Gamestate_Draw(struct Game *game, struct GamestateResources* data) {
 	}
 
 	if (data->stage) {
-		DrawScaledCharacter(game, data->fire, al_map_rgb(255,255,255), game->viewport.width / (float)3840, game->viewport.height / (float)2160, 0);
+		int fire_scale = game->data->quality.sprite_scale;
+		SubmitCharacter(game, data, data->fire, fire_scale * game->viewport.width / (float)3840, fire_scale * game->viewport.height / (float)2160);
 	} else {
-		al_draw_text(data->font, al_map_rgba_f(data->rand, data->rand, data->rand, data->rand), game->viewport.width / 2, game->viewport.height * 0.3, ALLEGRO_ALIGN_CENTER, "The Blind Date");
+		HoldDrawing(data, true);
+		SubmitText(data, data->font, al_map_rgba_f(data->rand, data->rand, data->rand, data->rand), game->viewport.width / 2, game->viewport.height * 0.3, "The Blind Date");
 		if (data->blink_counter < 40) {
 			char *text = "Press SPACE...";
 #ifdef ALLEGRO_ANDROID
 			text = "Touch to start...";
 #endif
-			al_draw_text(data->smallfont, al_map_rgba_f(data->rand, data->rand, data->rand, data->rand), game->viewport.width / 2, game->viewport.height * 0.55, ALLEGRO_ALIGN_CENTER, text);
+			SubmitText(data, data->smallfont, al_map_rgba_f(data->rand, data->rand, data->rand, data->rand), game->viewport.width / 2, game->viewport.height * 0.55, text);
 		}
+		HoldDrawing(data, false);
 	}
 
-
 	if (data->text) {
 		if (data->player) {
 			float pos = 0.85;
@@ -706,60 +1766,103 @@ void Gamestate_Draw(struct Game *game, struct GamestateResources* data) {
 				pos = 0.75;
 			}
 			if (data->stage >= 4) {
-				al_draw_filled_rectangle(0, game->viewport.height * (pos - 0.02), game->viewport.width, game->viewport.height, al_map_rgba(0,0,0,128));
+				SubmitRectangle(data, 0, game->viewport.height * (pos - 0.02), game->viewport.width, game->viewport.height, al_map_rgba(0,0,0,128));
 			}
 
-			WrappedTextWithShadow(game, data->smallfont, al_map_rgba_f(1,1,1,1), game->viewport.width * 0.05, game->viewport.height * pos, game->viewport.width * 0.9, ALLEGRO_ALIGN_CENTER, data->text);
+			// every line along with its shadow comes from the same glyph sheet, so it's all one submission
+			HoldDrawing(data, true);
+			SubmitWrappedText(game, data, game->viewport.height * pos, data->text);
+			HoldDrawing(data, false);
 
 		} else {
 			if (data->stage >= 4) {
-				al_draw_filled_rectangle(0, 0, game->viewport.width, game->viewport.height * 0.15,  al_map_rgba(0,0,0,128));
+				SubmitRectangle(data, 0, 0, game->viewport.width, game->viewport.height * 0.15,  al_map_rgba(0,0,0,128));
 			}
-			WrappedTextWithShadow(game, data->smallfont, al_map_rgba_f(1,1,1,1), game->viewport.width * 0.05, game->viewport.height * 0.05, game->viewport.width * 0.9, ALLEGRO_ALIGN_CENTER, data->text);
+			HoldDrawing(data, true);
+			SubmitWrappedText(game, data, game->viewport.height * 0.05, data->text);
+			HoldDrawing(data, false);
 		}
 	}
 
 	if (data->drawing) {
-		al_draw_filled_rectangle(0, 0, al_get_display_width(game->display), al_get_display_height(game->display), al_map_rgba(0,0,0,127));
-		al_draw_tinted_scaled_bitmap(data->drawbmp, al_map_rgba(127,127,127,127), 0, 0, al_get_bitmap_width(data->drawbmp), al_get_bitmap_height(data->drawbmp), 0, 0, game->viewport.width, game->viewport.height, 0);
-		al_draw_scaled_bitmap(data->canvas, 0, 0, al_get_bitmap_width(data->canvas), al_get_bitmap_height(data->canvas), 0, 0, game->viewport.width, game->viewport.height, 0);
+		SubmitRectangle(data, 0, 0, al_get_bitmap_width(target), al_get_bitmap_height(target), al_map_rgba(0,0,0,127));
+		if (data->coverage) {
+			UseShader(data, data->coverage);
+		}
+		SubmitBitmap(data, data->drawbmp, al_map_rgba(127,127,127,127), 0, 0, game->viewport.width, game->viewport.height);
+		SubmitBitmap(data, data->canvas, al_map_rgb(255,255,255), 0, 0, game->viewport.width, game->viewport.height);
+		if (data->coverage) {
+			UseShader(data, NULL);
+		}
+
+		float px, py;
+		if (data->touch && PredictStroke(&data->prediction, al_get_time(), &px, &py)) {
+			// provisional, until the next touch event draws the real segment onto the canvas
+			float sx = game->viewport.width / (float)al_get_bitmap_width(data->canvas);
+			float sy = game->viewport.height / (float)al_get_bitmap_height(data->canvas);
+			SubmitLine(data, data->x * sx, data->y * sy, px * sx, py * sy, al_map_rgb(255,255,255), 13 * sx);
+			SubmitRoundedRectangle(data, (px-5) * sx, (py-5) * sy, (px+5) * sx, (py+5) * sy, 2 * sx, 2 * sy, al_map_rgb(255,255,255));
+		}
 
-		al_draw_filled_rectangle(0, game->viewport.height*0.98, game->viewport.width * data->timeleft / (float)data->time, game->viewport.height, al_map_rgb(255,255,255));
+		// the timer and the meter go out together
+		struct RectangleBatch batch = { .count = 0 };
+		AddRectangle(&batch, 0, game->viewport.height*0.98, game->viewport.width * data->timeleft / (float)data->time, game->viewport.height, al_map_rgb(255,255,255));
+		DrawMeter(game, data, &batch);
+		DrawRectangles(data, &batch);
 
 		float x = data->x; float y = data->y;
 		x /= (float)al_get_bitmap_width(data->canvas);// * (float)game->viewport.width;
 		y /= (float)al_get_bitmap_height(data->canvas);// * (float)game->viewport.height;
 		if (!data->touch) {
 			ALLEGRO_BITMAP *pointer = data->button ? data->pencil : data->pointer;
-			al_draw_scaled_bitmap(pointer, 0, 0, al_get_bitmap_width(pointer), al_get_bitmap_height(pointer),
-			                      x * game->viewport.width, y * game->viewport.height,
-			                      game->viewport.width * 0.05, game->viewport.height * 0.06, 0);
+			SubmitBitmap(data, pointer, al_map_rgb(255,255,255), x * game->viewport.width, y * game->viewport.height,
+			             game->viewport.width * 0.05, game->viewport.height * 0.06);
 		}
 
 	}
 
 	if (data->end) {
+		// both words share the glyph sheet and both hearts the same bitmap
+		HoldDrawing(data, true);
 
-		al_draw_text(data->font, al_map_rgba_f(data->rand, data->rand, data->rand, data->rand), game->viewport.width * 0.2, game->viewport.height * 0.3, ALLEGRO_ALIGN_CENTER, "LOVE");
-		al_draw_text(data->font, al_map_rgba_f(data->rand, data->rand, data->rand, data->rand), game->viewport.width * 0.83, game->viewport.height * 0.6, ALLEGRO_ALIGN_CENTER, "LOVE");
+		SubmitText(data, data->font, al_map_rgba_f(data->rand, data->rand, data->rand, data->rand), game->viewport.width * 0.2, game->viewport.height * 0.3, "LOVE");
+		SubmitText(data, data->font, al_map_rgba_f(data->rand, data->rand, data->rand, data->rand), game->viewport.width * 0.83, game->viewport.height * 0.6, "LOVE");
 
-		al_draw_scaled_bitmap(data->heart, 0, 0, al_get_bitmap_width(data->heart), al_get_bitmap_height(data->heart),
-		                      (0.1 + cos(data->hearts) * 0.15) * game->viewport.width, data->heart1 * game->viewport.height,
-		                      game->viewport.width * 0.06, game->viewport.height * 0.12, 0);
+		SubmitBitmap(data, data->heart, al_map_rgb(255,255,255), (0.1 + cos(data->hearts) * 0.15) * game->viewport.width, data->heart1 * game->viewport.height,
+		             game->viewport.width * 0.06, game->viewport.height * 0.12);
 
-		al_draw_scaled_bitmap(data->heart, 0, 0, al_get_bitmap_width(data->heart), al_get_bitmap_height(data->heart),
-		                      (0.85 - sin(data->hearts) * 0.15) * game->viewport.width, data->heart2 * game->viewport.height,
-		                      game->viewport.width * 0.06, game->viewport.height * 0.12, 0);
+		SubmitBitmap(data, data->heart, al_map_rgb(255,255,255), (0.85 - sin(data->hearts) * 0.15) * game->viewport.width, data->heart2 * game->viewport.height,
+		             game->viewport.width * 0.06, game->viewport.height * 0.12);
 
+		HoldDrawing(data, false);
+	}
+	LATENCY_DRAWN(al_get_time()); // everything that came in so far is on this frame
+
+	data->stats_frames++;
+	data->stats_draw_calls += data->draw_calls;
+	data->stats_state_changes += data->state_changes;
+	if (data->stats_frames == STATS_FRAMES) {
+		if (game->config.debug) {
+			PrintConsole(game, "%.1f draw calls, %.1f state changes per frame", data->stats_draw_calls / (float)STATS_FRAMES,
+			             data->stats_state_changes / (float)STATS_FRAMES);
+		}
+		data->stats_frames = 0;
+		data->stats_draw_calls = 0;
+		data->stats_state_changes = 0;
 	}
-
 }
 
+
 void Gamestate_ProcessEvent(struct Game *game, struct GamestateResources* data, ALLEGRO_EVENT *ev) {
 	// Called for each event in Allegro event queue.
 	// Here you can handle user input, expiring timers etc.
 	TM_HandleEvent(data->timeline, ev);
 
+	if (ev->type == ALLEGRO_EVENT_DISPLAY_RESIZE) {
+		// libsuperderpy has set up the new viewport by now, so tmp doesn't wait for the next tick to match it
+		CheckViewport(game);
+	}
+
 	if ((ev->type==ALLEGRO_EVENT_KEY_DOWN) && (ev->keyboard.keycode == ALLEGRO_KEY_ESCAPE)) {
 		UnloadCurrentGamestate(game); // mark this gamestate to be stopped and unloaded
 		// When there are no active gamestates, the engine will quit.
@@ -777,8 +1880,15 @@ void Gamestate_ProcessEvent(struct Game *game, struct GamestateResources* data,
 			y *= al_get_bitmap_height(data->canvas) / (float)game->viewport.height;
 			data->x = x;
 			data->y = y;
+			ResetPrediction(&data->prediction);
+			if (ev->type==ALLEGRO_EVENT_TOUCH_BEGIN) {
+				RecordPrediction(&data->prediction, x, y, ev->touch.timestamp);
+			}
 		}
 	}
+	if ((ev->type==ALLEGRO_EVENT_TOUCH_END) || (ev->type==ALLEGRO_EVENT_TOUCH_CANCEL)) {
+		ResetPrediction(&data->prediction);
+	}
 	if (ev->type==ALLEGRO_EVENT_MOUSE_BUTTON_UP) {
 		if (ev->mouse.button==1) {
 			//data->button = false;
@@ -794,12 +1904,12 @@ void Gamestate_ProcessEvent(struct Game *game, struct GamestateResources* data,
 		WindowCoordsToViewport(game, &x, &y);
 		x *= al_get_bitmap_width(data->canvas) / (float)game->viewport.width;
 		y *= al_get_bitmap_height(data->canvas) / (float)game->viewport.height;
-		if ((data->button) || ((ev->type==ALLEGRO_EVENT_TOUCH_MOVE) && (ev->touch.primary))) {
-			al_set_target_bitmap(data->canvas);
-			al_draw_line(data->x, data->y, x, y, al_map_rgb(255,255,255), 13);
-			al_draw_filled_rounded_rectangle(x-5, y-5, x+5, y+5, 2, 2, al_map_rgb(255,255,255));
-
-			al_set_target_backbuffer(game->display);
+		if (data->drawing && ((data->button) || ((ev->type==ALLEGRO_EVENT_TOUCH_MOVE) && (ev->touch.primary)))) {
+			DrawStrokeSegment(data, x, y);
+			LATENCY_INPUT(ev->any.timestamp);
+		}
+		if ((ev->type==ALLEGRO_EVENT_TOUCH_MOVE) && ev->touch.primary) {
+			RecordPrediction(&data->prediction, x, y, ev->touch.timestamp);
 		}
 		data->x = x;
 		data->y = y;
@@ -835,7 +1945,7 @@ void Gamestate_ProcessEvent(struct Game *game, struct GamestateResources* data,
 	if (((ev->type==ALLEGRO_EVENT_KEY_DOWN) && (ev->keyboard.keycode == ALLEGRO_KEY_SPACE)) ||
 	  (ev->type==ALLEGRO_EVENT_TOUCH_BEGIN)) {
 		if (data->stage == 0){
-			TM_AddAction(data->timeline, &DecideWhatToDo, TM_AddToArgs(NULL, 1, data), "start");
+			QueueAction(data, &DecideWhatToDo, data, "start");
 			data->stage++;
 			return;
 		}
@@ -849,166 +1959,270 @@ void Gamestate_ProcessEvent(struct Game *game, struct GamestateResources* data,
 		}
 	}
 
-	if (ev->type == ALLEGRO_EVENT_DISPLAY_RESIZE) {
-		al_destroy_bitmap(data->tmp);
-		data->tmp = CreateNotPreservedBitmap(game->viewport.width, game->viewport.height);
-		al_destroy_font(data->font);
-		data->font = al_load_font(GetDataFilePath(game, "fonts/VINCHAND.ttf"), game->viewport.height * 0.2, 0);
-		al_destroy_font(data->smallfont);
-		data->smallfont = al_load_font(GetDataFilePath(game, "fonts/VINCHAND.ttf"), game->viewport.height * 0.072, 0);
-	}
 }
 
-void GenerateLight(ALLEGRO_BITMAP *bitmap, int maxr) {
-	int width = al_get_bitmap_width(bitmap);
-	int height = al_get_bitmap_height(bitmap);
-	ALLEGRO_LOCKED_REGION *region = al_lock_bitmap(bitmap, ALLEGRO_PIXEL_FORMAT_RGBA_8888, ALLEGRO_LOCK_WRITEONLY);
-	unsigned char *d = region->data;
-	for (int x = 0; x < width; x++) {
-		for (int y = 0; y < height; y++) {
-			float r = sqrt(pow(x-325, 2) + pow(y-256, 2));
-			for (int z = 0; z < region->pixel_size; z++) {
-				d[x * region->pixel_size + region->pitch * y + z] = fmin(255, fmax(0, maxr - r) * (256 / (float)maxr) * 4);
-				if (!r) {
-					d[x * region->pixel_size + region->pitch * y + z] = 255;
-				}
-			}
-		}
+void ViewportChanged(struct Game *game, void *ptr, int old_width, int old_height, int width, int height) {
+	// Only what depends on the size gets rebuilt, and only if it actually ends up different. The scaled
+	// background takes care of itself in Draw and the fonts are loaded on the workers, with their glyphs
+	// rendered over the next few ticks, so the only thing made right here is tmp, which is just an allocation.
+	struct GamestateResources *data = ptr;
+	if ((al_get_bitmap_width(data->tmp) != width) || (al_get_bitmap_height(data->tmp) != height)) {
+		DestroyTrackedBitmap(game, data->tmp);
+		data->tmp = TrackBitmap(game, "date", "tmp", CreateNotPreservedBitmap(width, height));
+	}
+	if ((int)(height * 0.2) != data->font_target.cache_param) {
+		RequestFont(game, &data->font_target, height * 0.2);
+	}
+	if ((int)(height * 0.072) != data->smallfont_target.cache_param) {
+		RequestFont(game, &data->smallfont_target, height * 0.072);
 	}
-	al_unlock_bitmap(bitmap);
 }
 
 void* Gamestate_Load(struct Game *game, void (*progress)(struct Game*)) {
 	// Called once, when the gamestate library is being loaded.
 	// Good place for allocating memory, loading bitmaps etc.
+	double start = al_get_time();
+	TRACE_BEGIN("date: Gamestate_Load");
+	TRACE_BEGIN("date: setup");
 
-	al_set_new_bitmap_flags(ALLEGRO_MIN_LINEAR | ALLEGRO_MAG_LINEAR);
-
-	struct GamestateResources *data = malloc(sizeof(struct GamestateResources));
-	data->font = al_load_font(GetDataFilePath(game, "fonts/VINCHAND.ttf"), game->viewport.height * 0.2, 0);
-	data->smallfont = al_load_font(GetDataFilePath(game, "fonts/VINCHAND.ttf"), game->viewport.height * 0.072, 0);
-
-	data->bg = al_load_bitmap(GetDataFilePath(game, "bg.png"));
-	progress(game); // report that we progressed with the loading, so the engine can draw a progress bar
-	data->canvas = al_create_bitmap(320*2, 180*2);
-	progress(game); // report that we progressed with the loading, so the engine can draw a progress bar
+	al_set_new_bitmap_flags(game->data->quality.bitmap_flags);
+	ALLEGRO_BITMAP *target = al_get_target_bitmap();
 
-	data->bgnoise = al_load_audio_stream(GetDataFilePath(game, "bg.ogg"), 4, 1024);
-	al_attach_audio_stream_to_mixer(data->bgnoise, game->audio.fx);
-	al_set_audio_stream_playmode(data->bgnoise, ALLEGRO_PLAYMODE_LOOP);
-	al_set_audio_stream_gain(data->bgnoise, 0.5);
-	al_set_audio_stream_playing(data->bgnoise, false);
+	struct GamestateResources *data = calloc(1, sizeof(struct GamestateResources));
+	data->load_start = start;
+	data->interactive = false;
 
-	data->careless = al_load_audio_stream(GetDataFilePath(game, "careless.ogg"), 4, 1024);
-	al_attach_audio_stream_to_mixer(data->careless, game->audio.music);
-	al_set_audio_stream_playmode(data->careless, ALLEGRO_PLAYMODE_LOOP);
-	al_set_audio_stream_playing(data->careless, false);
+	// Decoding happens on worker threads into memory bitmaps while the display thread sets up the rest.
+	// Most of it has usually been started already by PreloadDate during the splash screens.
+	struct LoadTarget targets[LOAD_TARGETS];
+	int count = 0;
 
+	data->warthog = CreateCharacter(game, "warthog");
+	data->table = CreateCharacter(game, "table");
+	data->fire = CreateCharacter(game, "fire");
 
+	// the happy warthog is only needed at the end, so it's streamed in once the date gets close to it
+	RegisterSpritesheet(game, data->warthog, "happy");
+	struct Spritesheet *happy = data->warthog->spritesheets;
+	while (strcmp(happy->name, "happy") != 0) {
+		happy = happy->next;
+	}
+	InitResident(&data->residents[RESIDENT_HAPPY], LOAD_TARGET_SPRITESHEET, happy, GetDataFilePath(game, "sprites/warthog/happy.png"), 5, 5);
+
+	// the same list PreloadDate went through, so these are usually decoded already
+#define QUEUE_SPRITESHEET(character, name, field) AddSpritesheetJob(game, targets, &count, data->field, name);
+#define QUEUE_LIGHT(maxr, field) AddLightJob(game, targets, &count, maxr, &data->field);
+#define QUEUE_BITMAP(filename, field) AddBitmapJob(game, targets, &count, filename, &data->field);
+#define QUEUE_STREAM(filename, field) AddStreamJob(game, targets, &count, filename, &data->field);
+	DATE_ASSETS(QUEUE_SPRITESHEET, QUEUE_LIGHT, QUEUE_BITMAP, QUEUE_STREAM)
+	data->scaledbg = NULL; // made on the first frame, once bg is there
+
+	data->font_target = (struct LoadTarget){ .type = LOAD_TARGET_FONT, .ptr = &data->font,
+	                                         .cache_name = "fonts/VINCHAND.ttf", .cache_param = game->viewport.height * 0.2 };
+	data->smallfont_target = (struct LoadTarget){ .type = LOAD_TARGET_FONT, .ptr = &data->smallfont,
+	                                              .cache_name = "fonts/VINCHAND.ttf", .cache_param = game->viewport.height * 0.072 };
+	data->font = AcquireFont(game, "date", data->font_target.cache_name, data->font_target.cache_param);
+	data->smallfont = AcquireFont(game, "date", data->smallfont_target.cache_name, data->smallfont_target.cache_param);
+
+	data->coverage = CreateCoverageShader(game);
+	data->coverage_format = data->coverage ? ALLEGRO_PIXEL_FORMAT_SINGLE_CHANNEL_8 : ALLEGRO_PIXEL_FORMAT_ANY;
+
+	int format = al_get_new_bitmap_format();
+	if (data->coverage) {
+		al_set_new_bitmap_format(data->coverage_format);
+	}
+	// not scaled with the quality, as every stroke, symbol and score is in its pixels (see quality.h)
+	data->canvas = TrackBitmap(game, "date", "canvas", al_create_bitmap(320*2, 180*2));
+	al_set_new_bitmap_format(format);
 	al_set_target_bitmap(data->canvas);
 	al_clear_to_color(al_map_rgba(0, 0, 0, 0));
-	al_set_target_backbuffer(game->display);
-
-	progress(game); // report that we progressed with the loading, so the engine can draw a progress bar
-
-	data->tmp = CreateNotPreservedBitmap(game->viewport.width, game->viewport.height);
-
-	data->light1 = al_create_bitmap(320*2, 180*2);
-	data->light2 = al_create_bitmap(320*2, 180*2);
-	data->light3 = al_create_bitmap(320*2, 180*2);
-	data->light4 = al_create_bitmap(320*2, 180*2);
-
-	GenerateLight(data->light1, 32);
-	progress(game); // report that we progressed with the loading, so the engine can draw a progress bar
-	GenerateLight(data->light2, 64);
-	progress(game); // report that we progressed with the loading, so the engine can draw a progress bar
-	GenerateLight(data->light3, 128);
-	progress(game); // report that we progressed with the loading, so the engine can draw a progress bar
 
+	data->light4 = TrackBitmap(game, "date", "light4", al_create_bitmap(320*2, 180*2));
 	al_set_target_bitmap(data->light4);
 	al_clear_to_color(al_map_rgb(255,255,255));
-	al_set_target_backbuffer(game->display);
+	al_set_target_bitmap(target);
 
-	data->warthog = CreateCharacter(game, "warthog");
-	data->table = CreateCharacter(game, "table");
-	data->fire = CreateCharacter(game, "fire");
-
-	RegisterSpritesheet(game, data->warthog, "1");
-	RegisterSpritesheet(game, data->warthog, "2");
-	RegisterSpritesheet(game, data->warthog, "3");
-	RegisterSpritesheet(game, data->warthog, "happy");
-	RegisterSpritesheet(game, data->table, "1");
-	RegisterSpritesheet(game, data->table, "2");
-	RegisterSpritesheet(game, data->table, "3");
-	RegisterSpritesheet(game, data->fire, "fire");
-	LoadSpritesheets(game, data->warthog);
-	progress(game); // report that we progressed with the loading, so the engine can draw a progress bar
-	LoadSpritesheets(game, data->table);
-	progress(game); // report that we progressed with the loading, so the engine can draw a progress bar
-	LoadSpritesheets(game, data->fire);
-
-//	ALLEGRO_BITMAP *sn, *sheart, *sberry, *swarthog;
-	data->sn = al_load_bitmap(GetDataFilePath(game, "symbols/n.png"));
-	data->sheart = al_load_bitmap(GetDataFilePath(game, "symbols/heart.png"));
-	data->sberry = al_load_bitmap(GetDataFilePath(game, "symbols/berry.png"));
-	data->swarthog = al_load_bitmap(GetDataFilePath(game, "symbols/warthog.png"));
+	data->tmp = TrackBitmap(game, "date", "tmp", CreateNotPreservedBitmap(game->viewport.width, game->viewport.height));
+	AddViewportListener(game, ViewportChanged, data);
 
 	data->timeline = TM_Init(game, "timeline");
+	data->dialogue = LoadDialogue(game, "dialogue.bin");
+	if (data->dialogue) {
+		for (int i = 0; i < data->dialogue->string_count; i++) {
+			if (!data->dialogue->voices[i]) {
+				AddGlyphs(data, data->dialogue->strings[i]);
+			}
+		}
+	}
+	AddGlyphs(data, "The Blind Date LOVE Press SPACE... Touch to start...");
+	data->glyph_target = al_create_bitmap(1, 1);
+	data->cues = CreatePool(sizeof(struct Cue), CUE_POOL_SIZE);
+	data->stroke = malloc(STROKE_SEGMENTS * sizeof(struct StrokeSegment));
+	data->stroke_count = 0;
+	ResetPrediction(&data->prediction);
+	data->drawfield = NULL;
+	data->meter_width = al_get_bitmap_width(data->canvas) / METER_CELL;
+	data->meter_height = al_get_bitmap_height(data->canvas) / METER_CELL;
+	data->meter_grid = calloc(data->meter_width * data->meter_height, 1);
+	data->stats_frames = 0;
+	data->stats_draw_calls = 0;
+	data->stats_state_changes = 0;
+	ResetMeter(data);
+
+	char *scoring = GetConfigOption(game, "BlindDate", "scoring");
+	data->distance_scoring = scoring && !strcmp(scoring, "distance");
+	free(scoring);
+
+	// autoplay=<seed> makes the game play itself, for soak testing
+	char *autoplay = GetConfigOption(game, "BlindDate", "autoplay");
+	data->autoplay = autoplay;
+	data->autoplay_rng = autoplay ? strtoul(autoplay, NULL, 10) : 0;
+	if (!data->autoplay_rng) {
+		data->autoplay_rng = 1; // xorshift would stay at zero forever
+	}
+	free(autoplay);
+	char *speed = GetConfigOption(game, "BlindDate", "autoplay_speed");
+	data->autoplay_speed = speed ? fmax(1, atoi(speed)) : AUTOPLAY_SPEED;
+	free(speed);
+	data->autoplay_runs = 0;
+	data->autoplay_passed = 0;
+	data->autoplay_failed = 0;
+	data->autoplay_mismatches = 0;
+	data->actions = 0;
+	if (data->autoplay) {
+		PrintConsole(game, "Autoplay at %dx speed, seed %u", data->autoplay_speed, data->autoplay_rng);
+	}
+
+	// The rest is streamed in by UpdateResidency as the stages go; the first symbol is usually preloaded.
+	static char *symbols[DIALOGUE_SYMBOL_COUNT] = { "symbols/n.png", "symbols/heart.png", "symbols/berry.png", "symbols/warthog.png" };
+	for (int i = 0; i < DIALOGUE_SYMBOL_COUNT; i++) {
+		int from, to;
+		GetSymbolStages(data->dialogue, i, &from, &to);
+		data->symbols[i] = NULL;
+		InitResident(&data->residents[i], LOAD_TARGET_BITMAP, &data->symbols[i], GetDataFilePath(game, symbols[i]), from, to);
+		data->residents[i].target.format = data->coverage_format;
+		data->fields[i] = NULL;
+		data->residents[i].target.field = &data->fields[i];
+	}
+	data->careless = NULL;
+	InitResident(&data->residents[RESIDENT_CARELESS], LOAD_TARGET_STREAM, &data->careless, GetDataFilePath(game, "careless.ogg"), 5, 5);
+	TRACE_END();
+	progress(game); // report that we progressed with the loading, so the engine can draw a progress bar
+	for (int i = 0; i < count; i++) {
+		if (!targets[i].loading) {
+			progress(game); // found in the cache, so there's nothing to wait for
+		}
+	}
 
-	data->pointer =  al_load_bitmap(GetDataFilePath(game, "point.png"));
-	data->pencil =  al_load_bitmap(GetDataFilePath(game, "draw.png"));
+	struct LoaderJob *job;
+	while (true) {
+		TRACE_BEGIN("date: wait");
+		job = WaitForLoaderJob(game->data->loader);
+		TRACE_END();
+		if (!job) {
+			break;
+		}
+		TRACE_BEGIN_ARG("date: upload", job->path);
+		FinishLoaderJob(game, job);
+		DestroyLoaderJob(job);
+		TRACE_END();
+		progress(game); // one step per decoded asset
+	}
 
-	data->heart = al_load_bitmap(GetDataFilePath(game, "heart.png"));
+	al_attach_audio_stream_to_mixer(data->bgnoise, game->audio.fx);
+	al_set_audio_stream_playmode(data->bgnoise, ALLEGRO_PLAYMODE_LOOP);
+	al_set_audio_stream_gain(data->bgnoise, 0.5);
+	al_set_audio_stream_playing(data->bgnoise, false);
 
-	progress(game); // report that we progressed with the loading, so the engine can draw a progress bar
+	TRACE_END();
+	PrintConsole(game, "Date loaded in %f s", al_get_time() - start);
+	ReportAssets(game, "date");
 	return data;
 }
 
 void Gamestate_Unload(struct Game *game, struct GamestateResources* data) {
 	// Called when the gamestate library is being unloaded.
 	// Good place for freeing all allocated memory and resources.
+	RemoveViewportListener(game, ViewportChanged, data);
+	FinishJobs(game, game->data->jobs); // the scoring may still be going
+	struct LoaderJob *job;
+	while ((job = WaitForLoaderJob(game->data->loader))) {
+		// let the streamed in assets and voices land where the code below can free them
+		FinishLoaderJob(game, job);
+		DestroyLoaderJob(job);
+	}
+	if (data->autoplay) {
+		ReportAutoplay(game, data);
+	}
 	TM_Destroy(data->timeline);
+	DestroyDialogue(data->dialogue);
+	PrintConsole(game, "Cues: peak %d, %d mallocs", data->cues->peak, data->cues->mallocs);
+	DestroyPool(data->cues);
+	free(data->stroke);
+	free(data->meter_grid);
+	free(data->stroke_coverage.nearest);
+	free(data->meter_coverage.nearest);
+
+	ReleaseCached(game, "date", data->font);
+	ReleaseCached(game, "date", data->smallfont);
+	ReleaseCached(game, "date", data->font_target.warming);
+	ReleaseCached(game, "date", data->smallfont_target.warming);
+	free(data->glyphs);
+	al_destroy_bitmap(data->glyph_target);
+
+	DestroyTrackedBitmap(game, data->canvas);
+	if (data->coverage) {
+		al_destroy_shader(data->coverage);
+	}
+	ReleaseCached(game, "date", data->pointer);
+	ReleaseCached(game, "date", data->pencil);
+	for (int i = 0; i < DIALOGUE_SYMBOL_COUNT; i++) {
+		DestroyTrackedBitmap(game, data->symbols[i]);
+		DestroyDistanceField(data->fields[i]);
+	}
 
-	al_destroy_font(data->font);
-	al_destroy_font(data->smallfont);
-
-	al_destroy_bitmap(data->canvas);
-	al_destroy_bitmap(data->pointer);
-	al_destroy_bitmap(data->pencil);
-	al_destroy_bitmap(data->sn);
-	al_destroy_bitmap(data->sheart);
-	al_destroy_bitmap(data->sberry);
-	al_destroy_bitmap(data->swarthog);
-
-	al_destroy_bitmap(data->tmp);
-	al_destroy_bitmap(data->heart);
-
-	al_destroy_bitmap(data->light1);
-	al_destroy_bitmap(data->light2);
-	al_destroy_bitmap(data->light3);
-	al_destroy_bitmap(data->light4);
-	al_destroy_bitmap(data->bg);
+	DestroyTrackedBitmap(game, data->tmp);
+	ReleaseCached(game, "date", data->heart);
+
+	ReleaseCached(game, "date", data->light1);
+	ReleaseCached(game, "date", data->light2);
+	ReleaseCached(game, "date", data->light3);
+	DestroyTrackedBitmap(game, data->light4);
+	ReleaseCached(game, "date", data->bg);
+	DestroyTrackedBitmap(game, data->scaledbg);
+	UntrackCharacter(game, data->fire);
+	UntrackCharacter(game, data->warthog);
+	UntrackCharacter(game, data->table);
 	DestroyCharacter(game, data->fire);
 	DestroyCharacter(game, data->warthog);
 	DestroyCharacter(game, data->table);
 
-	al_destroy_audio_stream(data->bgnoise);
-	al_destroy_audio_stream(data->careless);
+	DestroyTrackedStream(game, data->bgnoise);
+	DestroyTrackedStream(game, data->careless);
+	for (int i = 0; i < RESIDENT_COUNT; i++) {
+		free(data->residents[i].path);
+	}
+	CheckAssetLeaks(game, "date");
 
 	free(data);
 }
 
 void Gamestate_Start(struct Game *game, struct GamestateResources* data) {
+	TRACE_INSTANT("date: Gamestate_Start");
 	// Called when this gamestate gets control. Good place for initializing state,
 	// playing music etc.
 	data->blink_counter = 0;
 	//al_show_mouse_cursor(game->display);
 	data->button = false;
 
-	ALLEGRO_MOUSE_STATE state;
-	al_get_mouse_state(&state);
-	data->x = state.x * al_get_bitmap_width(data->canvas) / (float)game->viewport.width;
-	data->y = state.y * al_get_bitmap_height(data->canvas) / (float)game->viewport.height;
+	data->x = 0;
+	data->y = 0;
+	if (al_is_mouse_installed()) {
+		ALLEGRO_MOUSE_STATE state;
+		al_get_mouse_state(&state);
+		data->x = state.x * al_get_bitmap_width(data->canvas) / (float)game->viewport.width;
+		data->y = state.y * al_get_bitmap_height(data->canvas) / (float)game->viewport.height;
+	}
 
 	SelectSpritesheet(game, data->warthog, "1");
 	SelectSpritesheet(game, data->table, "1");
@@ -1021,10 +2235,9 @@ void Gamestate_Start(struct Game *game, struct GamestateResources* data) {
 	data->drawing = false;
 data->end = false;
 data->timeleft = -1;
-  data->facts.bitten = false;
-	data->facts.name = false;
-	data->facts.weakness = false;
-	data->facts.crocodile = false;
+	for (int i = 0; i < DIALOGUE_FACT_COUNT; i++) {
+		data->facts[i] = false;
+	}
 	al_set_audio_stream_playing(data->bgnoise, true);
 data->text = NULL;
 data->drawbmp = NULL;
@@ -1033,6 +2246,7 @@ data->cheat = false;
 data->hearts = 0;
 data->heart1 = 1;
 data->heart2 = 1.5;
+data->autoplay_ticks = 0;
 
 data->touch = false;
 #ifdef ALLEGRO_ANDROID
@@ -1041,6 +2255,7 @@ data->touch = true;
 }
 
 void Gamestate_Stop(struct Game *game, struct GamestateResources* data) {
+	TRACE_INSTANT("date: Gamestate_Stop");
 	// Called when gamestate gets stopped. Stop timers, music etc. here.
 }
 
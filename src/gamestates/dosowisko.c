@@ -32,8 +32,14 @@ struct GamestateResources {
 		ALLEGRO_BITMAP *bitmap, *checkerboard, *pixelator;
 		int pos, fade, tick, tan;
 		char text[255];
-		bool underscore, fadeout;
+		bool underscore, fadeout, skip;
 		struct Timeline *timeline;
+
+		// what the bitmap and pixelator were last rendered with, so they're only redone when it changes
+		char shown[255];
+		bool shown_underscore;
+		int shown_fade, shown_tan;
+		bool dirty;
 };
 
 int Gamestate_ProgressCount = 5;
@@ -102,42 +108,62 @@ void Gamestate_Logic(struct Game *game, struct GamestateResources* data) {
 		data->underscore = !data->underscore;
 		data->tick = 0;
 	}
+	if (data->skip && IsDatePreloaded(game)) {
+		// don't switch before the date is ready, so it comes up without waiting on a loading screen
+		data->skip = false;
+		SwitchCurrentGamestate(game, SKIP_GAMESTATE);
+		if (strcmp(SKIP_GAMESTATE, NEXT_GAMESTATE) != 0) {
+			UnloadGamestate(game, NEXT_GAMESTATE);
+		}
+	}
 }
 
 void Gamestate_Draw(struct Game *game, struct GamestateResources* data) {
 
 	if (!data->fadeout) {
 
-		char t[255] = "";
-		strcpy(t, data->text);
-		if (data->underscore) {
-			strncat(t, "_", 1);
-		} else {
-			strncat(t, " ", 1);
-		}
+		int fade = data->fadeout ? 255 : data->fade;
+		bool text_changed = data->dirty || (data->underscore != data->shown_underscore) || strcmp(data->text, data->shown);
 
-		al_set_target_bitmap(data->bitmap);
-		al_clear_to_color(al_map_rgba(0,0,0,0));
+		if (text_changed) {
+			char t[255] = "";
+			strcpy(t, data->text);
+			if (data->underscore) {
+				strncat(t, "_", 1);
+			} else {
+				strncat(t, " ", 1);
+			}
 
-		al_draw_text(data->font, al_map_rgba(255,255,255,10), 320/2,
-		             180*0.4167, ALLEGRO_ALIGN_CENTRE, t);
+			al_set_target_bitmap(data->bitmap);
+			al_clear_to_color(al_map_rgba(0,0,0,0));
 
-		double tg = tan(-data->tan/384.0 * ALLEGRO_PI - ALLEGRO_PI/2);
+			al_draw_text(data->font, al_map_rgba(255,255,255,10), 320/2,
+			             180*0.4167, ALLEGRO_ALIGN_CENTRE, t);
 
-		int fade = data->fadeout ? 255 : data->fade;
+			strcpy(data->shown, data->text);
+			data->shown_underscore = data->underscore;
+		}
+
+		if (text_changed || (fade != data->shown_fade) || (data->tan != data->shown_tan)) {
+			double tg = tan(-data->tan/384.0 * ALLEGRO_PI - ALLEGRO_PI/2);
 
-		al_set_target_bitmap(data->pixelator);
-		al_clear_to_color(al_map_rgb(35, 31, 32));
+			al_set_target_bitmap(data->pixelator);
+			al_clear_to_color(al_map_rgb(35, 31, 32));
 
-		al_draw_tinted_scaled_bitmap(data->bitmap, al_map_rgba(fade, fade, fade, fade), 0, 0,
-		                             al_get_bitmap_width(data->bitmap), al_get_bitmap_height(data->bitmap),
-		                             -tg*al_get_bitmap_width(data->bitmap)*0.05,
-		                             -tg*al_get_bitmap_height(data->bitmap)*0.05,
-		                             al_get_bitmap_width(data->bitmap)+tg*0.1*al_get_bitmap_width(data->bitmap),
-		                             al_get_bitmap_height(data->bitmap)+tg*0.1*al_get_bitmap_height(data->bitmap),
-		                             0);
+			al_draw_tinted_scaled_bitmap(data->bitmap, al_map_rgba(fade, fade, fade, fade), 0, 0,
+			                             al_get_bitmap_width(data->bitmap), al_get_bitmap_height(data->bitmap),
+			                             -tg*al_get_bitmap_width(data->bitmap)*0.05,
+			                             -tg*al_get_bitmap_height(data->bitmap)*0.05,
+			                             al_get_bitmap_width(data->bitmap)+tg*0.1*al_get_bitmap_width(data->bitmap),
+			                             al_get_bitmap_height(data->bitmap)+tg*0.1*al_get_bitmap_height(data->bitmap),
+			                             0);
 
-		al_draw_bitmap(data->checkerboard, 0, 0, 0);
+			al_draw_bitmap(data->checkerboard, 0, 0, 0);
+
+			data->shown_fade = fade;
+			data->shown_tan = data->tan;
+			data->dirty = false;
+		}
 
 		al_set_target_backbuffer(game->display);
 
@@ -147,13 +173,16 @@ void Gamestate_Draw(struct Game *game, struct GamestateResources* data) {
 }
 
 void Gamestate_Start(struct Game *game, struct GamestateResources* data) {
+	TRACE_INSTANT("dosowisko: Gamestate_Start");
 	data->pos = 1;
 	data->fade = 0;
 	data->tan = 64;
 	data->tick = 0;
 	data->fadeout = false;
+	data->skip = false;
 	data->underscore=true;
 	strcpy(data->text, "#");
+	data->dirty = true;
 	TM_AddDelay(data->timeline, 300);
 	TM_AddQueuedBackgroundAction(data->timeline, FadeIn, TM_AddToArgs(NULL, 1, data), 0, "fadein");
 	TM_AddDelay(data->timeline, 1500);
@@ -171,83 +200,97 @@ void Gamestate_Start(struct Game *game, struct GamestateResources* data) {
 void Gamestate_ProcessEvent(struct Game *game, struct GamestateResources* data, ALLEGRO_EVENT *ev) {
 	TM_HandleEvent(data->timeline, ev);
 	if (((ev->type==ALLEGRO_EVENT_KEY_DOWN) && (ev->keyboard.keycode == ALLEGRO_KEY_ESCAPE)) || (ev->type == ALLEGRO_EVENT_TOUCH_END)) {
-		SwitchCurrentGamestate(game, SKIP_GAMESTATE);
-		if (strcmp(SKIP_GAMESTATE, NEXT_GAMESTATE) != 0) {
-			UnloadGamestate(game, NEXT_GAMESTATE);
-		}
+		data->skip = true;
 	}
 }
 
 void* Gamestate_Load(struct Game *game, void (*progress)(struct Game*)) {
+	TRACE_BEGIN("dosowisko: Gamestate_Load");
 	struct GamestateResources *data = malloc(sizeof(struct GamestateResources));
+	TRACE_BEGIN("dosowisko: checkerboard");
 	data->timeline = TM_Init(game, "main");
-	data->bitmap = CreateNotPreservedBitmap(320, 180);
-	data->checkerboard = al_create_bitmap(320, 180);
-	data->pixelator = CreateNotPreservedBitmap(320, 180);
-
-	al_set_target_bitmap(data->checkerboard);
-	al_lock_bitmap(data->checkerboard, ALLEGRO_PIXEL_FORMAT_ANY, ALLEGRO_LOCK_WRITEONLY);
-	int x, y;
-	for (x = 0; x < al_get_bitmap_width(data->checkerboard); x=x+2) {
-		for (y = 0; y < al_get_bitmap_height(data->checkerboard); y=y+2) {
-			al_put_pixel(x, y, al_map_rgba(0,0,0,64));
-			al_put_pixel(x+1, y, al_map_rgba(0,0,0,0));
-			al_put_pixel(x, y+1, al_map_rgba(0,0,0,0));
-			al_put_pixel(x+1, y+1, al_map_rgba(0,0,0,0));
+	data->bitmap = TrackBitmap(game, "dosowisko", "bitmap", CreateNotPreservedBitmap(320, 180));
+	data->checkerboard = TrackBitmap(game, "dosowisko", "checkerboard", al_create_bitmap(320, 180));
+	data->pixelator = TrackBitmap(game, "dosowisko", "pixelator", CreateNotPreservedBitmap(320, 180));
+
+	// every other pixel of every other row is black at 1/4 alpha, the rest is transparent
+	ALLEGRO_LOCKED_REGION *region = al_lock_bitmap(data->checkerboard, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_WRITEONLY);
+	for (int y = 0; y < al_get_bitmap_height(data->checkerboard); y++) {
+		unsigned char *row = (unsigned char*)region->data + y * region->pitch;
+		memset(row, 0, al_get_bitmap_width(data->checkerboard) * 4);
+		if (y % 2 == 0) {
+			for (int x = 0; x < al_get_bitmap_width(data->checkerboard); x += 2) {
+				row[x * 4 + 3] = 64;
+			}
 		}
 	}
 	al_unlock_bitmap(data->checkerboard);
-	al_set_target_backbuffer(game->display);
+	TRACE_END();
 	(*progress)(game);
 
-	data->font = al_load_ttf_font(GetDataFilePath(game, "fonts/DejaVuSansMono.ttf"),
-	                              (int)(180*0.1666 / 8) * 8, 0);
+	TRACE_BEGIN("dosowisko: font");
+	data->font = AcquireFont(game, "dosowisko", "fonts/DejaVuSansMono.ttf", (int)(180*0.1666 / 8) * 8);
+	TRACE_END();
 	(*progress)(game);
-	data->sample = al_load_sample( GetDataFilePath(game, "dosowisko.flac") );
+	TRACE_BEGIN("dosowisko: dosowisko.flac");
+	data->sample = AcquireSample(game, "dosowisko", "dosowisko.flac");
 	data->sound = al_create_sample_instance(data->sample);
 	al_attach_sample_instance_to_mixer(data->sound, game->audio.music);
 	al_set_sample_instance_playmode(data->sound, ALLEGRO_PLAYMODE_ONCE);
+	TRACE_END();
 	(*progress)(game);
 
-	data->kbd_sample = al_load_sample( GetDataFilePath(game, "kbd.flac") );
+	TRACE_BEGIN("dosowisko: kbd.flac");
+	data->kbd_sample = AcquireSample(game, "dosowisko", "kbd.flac");
 	data->kbd = al_create_sample_instance(data->kbd_sample);
 	al_attach_sample_instance_to_mixer(data->kbd, game->audio.fx);
 	al_set_sample_instance_playmode(data->kbd, ALLEGRO_PLAYMODE_ONCE);
+	TRACE_END();
 	(*progress)(game);
 
-	data->key_sample = al_load_sample( GetDataFilePath(game, "key.flac") );
+	TRACE_BEGIN("dosowisko: key.flac");
+	data->key_sample = AcquireSample(game, "dosowisko", "key.flac");
 	data->key = al_create_sample_instance(data->key_sample);
 	al_attach_sample_instance_to_mixer(data->key, game->audio.fx);
 	al_set_sample_instance_playmode(data->key, ALLEGRO_PLAYMODE_ONCE);
+	TRACE_END();
 	(*progress)(game);
 
+	ReportAssets(game, "dosowisko");
+	TRACE_END();
 	return data;
 }
 
 void Gamestate_Stop(struct Game *game, struct GamestateResources* data) {
+	TRACE_INSTANT("dosowisko: Gamestate_Stop");
 	al_stop_sample_instance(data->sound);
 	al_stop_sample_instance(data->kbd);
 	al_stop_sample_instance(data->key);
 }
 
 void Gamestate_Unload(struct Game *game, struct GamestateResources* data) {
-	al_destroy_font(data->font);
+	ReleaseCached(game, "dosowisko", data->font);
 	al_destroy_sample_instance(data->sound);
-	al_destroy_sample(data->sample);
+	ReleaseCached(game, "dosowisko", data->sample);
 	al_destroy_sample_instance(data->kbd);
-	al_destroy_sample(data->kbd_sample);
+	ReleaseCached(game, "dosowisko", data->kbd_sample);
 	al_destroy_sample_instance(data->key);
-	al_destroy_sample(data->key_sample);
-	al_destroy_bitmap(data->bitmap);
-	al_destroy_bitmap(data->checkerboard);
-	al_destroy_bitmap(data->pixelator);
+	ReleaseCached(game, "dosowisko", data->key_sample);
+	DestroyTrackedBitmap(game, data->bitmap);
+	DestroyTrackedBitmap(game, data->checkerboard);
+	DestroyTrackedBitmap(game, data->pixelator);
 	TM_Destroy(data->timeline);
+	CheckAssetLeaks(game, "dosowisko");
 	free(data);
 }
 
 void Gamestate_Reload(struct Game *game, struct GamestateResources* data) {
-	data->bitmap = CreateNotPreservedBitmap(320, 180);
-	data->pixelator = CreateNotPreservedBitmap(320, 180);
+	// the old ones are gone along with the display
+	UntrackAsset(game, data->bitmap);
+	UntrackAsset(game, data->pixelator);
+	data->bitmap = TrackBitmap(game, "dosowisko", "bitmap", CreateNotPreservedBitmap(320, 180));
+	data->pixelator = TrackBitmap(game, "dosowisko", "pixelator", CreateNotPreservedBitmap(320, 180));
+	data->dirty = true;
 }
 
 void Gamestate_Pause(struct Game *game, struct GamestateResources* data) {
@@ -20,6 +20,7 @@
  */
 
 #include "../common.h"
+#include <math.h>
 #include <libsuperderpy.h>
 
 #define NEXT_GAMESTATE "date"
@@ -29,7 +30,9 @@ struct GamestateResources {
 		// This struct is for every resource allocated and used by your gamestate.
 		// It gets created on load and then gets passed around to all other function calls.
 		ALLEGRO_BITMAP *bmp;
+		ALLEGRO_BITMAP *scaled; // bmp at the viewport size
 		int counter;
+		bool skip;
 
 		ALLEGRO_AUDIO_STREAM *monkeys;
 };
@@ -39,7 +42,10 @@ int Gamestate_ProgressCount = 1; // number of loading steps as reported by Games
 void Gamestate_Logic(struct Game *game, struct GamestateResources* data) {
 	// Called 60 times per second. Here you should do all your game logic.
 	data->counter++;
-	if (data->counter > 60*5.2) {
+	if (data->skip && IsDatePreloaded(game)) {
+		data->skip = false;
+		SwitchCurrentGamestate(game, SKIP_GAMESTATE);
+	} else if ((data->counter > 60*5.2) && IsDatePreloaded(game)) {
 		SwitchCurrentGamestate(game, NEXT_GAMESTATE);
 	}
 }
@@ -47,57 +53,66 @@ void Gamestate_Logic(struct Game *game, struct GamestateResources* data) {
 void Gamestate_Draw(struct Game *game, struct GamestateResources* data) {
 	// Called as soon as possible, but no sooner than next Gamestate_Logic call.
 	// Draw everything to the screen here.
-	al_clear_to_color(al_map_rgb(255,255,255));
-	al_draw_scaled_bitmap(data->bmp, 0, 0, al_get_bitmap_width(data->bmp), al_get_bitmap_height(data->bmp),
-	                      0, 0, game->viewport.width, game->viewport.height, 0);
+	data->scaled = PrescaleToViewport(game, "holypangolin", "holypangolin.png (scaled)", data->scaled, data->bmp);
 
-	if (data->counter < 320) {
-		al_draw_filled_rectangle(0, 0, game->viewport.width, game->viewport.height, al_map_rgba_f(1 - data->counter / 280.0, 1 - data->counter / 280.0, 1 - data->counter / 280.0, 1 - data->counter / 280.0));
-	}
+	// fading in from white by tinting gives the same result as covering it with a white rectangle
+	float fade = fmin(1, data->counter / 280.0);
+	al_clear_to_color(al_map_rgb(255,255,255));
+	al_draw_tinted_bitmap(data->scaled, al_map_rgba_f(fade, fade, fade, fade), 0, 0, 0);
 }
 
 void Gamestate_ProcessEvent(struct Game *game, struct GamestateResources* data, ALLEGRO_EVENT *ev) {
 	// Called for each event in Allegro event queue.
 	// Here you can handle user input, expiring timers etc.
 	if (((ev->type==ALLEGRO_EVENT_KEY_DOWN) && (ev->keyboard.keycode == ALLEGRO_KEY_ESCAPE)) || (ev->type == ALLEGRO_EVENT_TOUCH_END)) {
-		SwitchCurrentGamestate(game, SKIP_GAMESTATE);
+		data->skip = true;
 	}
 }
 
 void* Gamestate_Load(struct Game *game, void (*progress)(struct Game*)) {
 	// Called once, when the gamestate library is being loaded.
 	// Good place for allocating memory, loading bitmaps etc.
-	al_set_new_bitmap_flags(ALLEGRO_MIN_LINEAR | ALLEGRO_MAG_LINEAR);
+	al_set_new_bitmap_flags(game->data->quality.bitmap_flags);
 
+	TRACE_BEGIN("holypangolin: Gamestate_Load");
 	struct GamestateResources *data = malloc(sizeof(struct GamestateResources));
-	data->bmp = al_load_bitmap(GetDataFilePath(game, "holypangolin.png"));
+	data->bmp = AcquireBitmap(game, "holypangolin", "holypangolin.png");
+	data->scaled = PrescaleToViewport(game, "holypangolin", "holypangolin.png (scaled)", NULL, data->bmp);
 	progress(game); // report that we progressed with the loading, so the engine can draw a progress bar
 
-	data->monkeys = al_load_audio_stream(GetDataFilePath(game, "holypangolin.flac"), 4, 1024);
+	data->monkeys = TrackStream(game, "holypangolin", "holypangolin.flac",
+	                            al_load_audio_stream(GetDataFilePath(game, "holypangolin.flac"), game->data->quality.stream_buffers, game->data->quality.stream_samples));
 	al_set_audio_stream_playing(data->monkeys, false);
 	al_attach_audio_stream_to_mixer(data->monkeys, game->audio.fx);
 	al_set_audio_stream_gain(data->monkeys, 0.75);
 
+	ReportAssets(game, "holypangolin");
+	TRACE_END();
 	return data;
 }
 
 void Gamestate_Unload(struct Game *game, struct GamestateResources* data) {
 	// Called when the gamestate library is being unloaded.
 	// Good place for freeing all allocated memory and resources.
-	al_destroy_bitmap(data->bmp);
-	al_destroy_audio_stream(data->monkeys);
+	ReleaseCached(game, "holypangolin", data->bmp);
+	DestroyTrackedBitmap(game, data->scaled);
+	DestroyTrackedStream(game, data->monkeys);
+	CheckAssetLeaks(game, "holypangolin");
 	free(data);
 }
 
 void Gamestate_Start(struct Game *game, struct GamestateResources* data) {
 	// Called when this gamestate gets control. Good place for initializing state,
 	// playing music etc.
+	TRACE_INSTANT("holypangolin: Gamestate_Start");
 	data->counter = 0;
+	data->skip = false;
 	al_set_audio_stream_playing(data->monkeys, true);
 }
 
 void Gamestate_Stop(struct Game *game, struct GamestateResources* data) {
 	// Called when gamestate gets stopped. Stop timers, music etc. here.
+	TRACE_INSTANT("holypangolin: Gamestate_Stop");
 }
 
 void Gamestate_Pause(struct Game *game, struct GamestateResources* data) {
@@ -39,20 +39,23 @@ void Draw(struct Game *game, struct LoadingResources *data, float p) {
 }
 
 void* Load(struct Game *game) {
+	TRACE_BEGIN("loading: Load");
 	struct LoadingResources *data = malloc(sizeof(struct LoadingResources));
 	al_clear_to_color(al_map_rgb(0,0,0));
 
-	data->loading_bitmap = al_create_bitmap(game->viewport.width, game->viewport.height);
+	data->loading_bitmap = TrackBitmap(game, "loading", "loading_bitmap", al_create_bitmap(game->viewport.width, game->viewport.height));
 
 	al_set_target_bitmap(data->loading_bitmap);
 	al_clear_to_color(al_map_rgb(0,0,0));
 	al_draw_filled_rectangle(0, game->viewport.height * 0.98, game->viewport.width,
 	                         game->viewport.height, al_map_rgba(32,32,32,32));
 	al_set_target_bitmap(al_get_backbuffer(game->display));
+	TRACE_END();
 	return data;
 }
 void Unload(struct Game *game, struct LoadingResources *data) {
-	al_destroy_bitmap(data->loading_bitmap);
+	DestroyTrackedBitmap(game, data->loading_bitmap);
+	CheckAssetLeaks(game, "loading");
 	free(data);
 }
 
@@ -0,0 +1,66 @@
+/*! \file interpose.c
+ *  \brief Stands in for library functions in the dynamically linked executable, to time them.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <allegro5/allegro.h>
+#include "latency.h"
+#include "trace.h"
+
+// Being defined in the executable, these take precedence over the ones libsuperderpy would otherwise get from
+// libdl and Allegro, and hand the calls on to them through RTLD_NEXT. The static build wraps the same calls
+// in static.c.
+
+#ifdef BLINDDATE_TRACE
+void* dlopen(const char *filename, int flags) {
+	static void* (*real)(const char*, int);
+	if (!real) {
+		real = (void* (*)(const char*, int))dlsym(RTLD_NEXT, "dlopen");
+	}
+	// includes the constructors of the library and whatever it pulls in
+	TRACE_BEGIN_ARG("dlopen", filename ? filename : "(main program)");
+	void *handle = real(filename, flags);
+	TRACE_END();
+	return handle;
+}
+
+int dlclose(void *handle) {
+	static int (*real)(void*);
+	if (!real) {
+		real = (int (*)(void*))dlsym(RTLD_NEXT, "dlclose");
+	}
+	TRACE_BEGIN("dlclose");
+	int ret = real(handle);
+	TRACE_END();
+	return ret;
+}
+#endif
+
+#ifdef BLINDDATE_LATENCY
+// the moment a frame gets shown, as static.c catches it in the static build
+void al_flip_display(void) {
+	static void (*real)(void);
+	if (!real) {
+		real = (void (*)(void))dlsym(RTLD_NEXT, "al_flip_display");
+	}
+	real();
+	LATENCY_SHOWN(al_get_time());
+}
+#endif
@@ -0,0 +1,286 @@
+/*! \file jobs.c
+ *  \brief Background work shared by all gamestates.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <allegro5/allegro.h>
+#include "jobs.h"
+
+struct Job {
+		void (*work)(void *arg);
+		void (*done)(struct Game *game, void *arg);
+		void *arg;
+		struct Job *prev, *next;
+};
+
+// Each worker takes from the head of its own queue and steals from the tail of the others,
+// so a long job only holds up what was queued behind it until someone else runs out of work.
+struct JobQueue {
+		ALLEGRO_MUTEX *mutex;
+		struct Job *head, *tail;
+};
+
+struct Worker {
+		struct Jobs *jobs;
+		int index;
+		ALLEGRO_THREAD *thread;
+};
+
+struct Jobs {
+		struct JobQueue *queues; // one per worker
+		struct Worker *workers;
+		int queue_count, thread_count;
+		int next; // queue the next job goes to
+
+		ALLEGRO_MUTEX *mutex; // guards everything below; taken before a queue's mutex, never while holding one
+		ALLEGRO_COND *work_cond, *done_cond;
+		int pending; // queued and not taken by a worker yet
+		unsigned int queued; // ever, so that a worker can tell whether anything came since it last looked
+		int unfinished; // submitted and not completed yet, including the done() call
+		struct Job *completed, *completed_tail; // waiting for RunJobCompletions, in the order they were finished
+		bool stop;
+};
+
+static void Push(struct JobQueue *queue, struct Job *job) {
+	al_lock_mutex(queue->mutex);
+	job->prev = queue->tail;
+	job->next = NULL;
+	if (queue->tail) {
+		queue->tail->next = job;
+	} else {
+		queue->head = job;
+	}
+	queue->tail = job;
+	al_unlock_mutex(queue->mutex);
+}
+
+static struct Job* Take(struct JobQueue *queue, bool steal) {
+	al_lock_mutex(queue->mutex);
+	struct Job *job = steal ? queue->tail : queue->head;
+	if (job) {
+		if (job->prev) {
+			job->prev->next = job->next;
+		} else {
+			queue->head = job->next;
+		}
+		if (job->next) {
+			job->next->prev = job->prev;
+		} else {
+			queue->tail = job->prev;
+		}
+	}
+	al_unlock_mutex(queue->mutex);
+	return job;
+}
+
+static struct Job* TakeJob(struct Jobs *jobs, int index) {
+	struct Job *job = Take(&jobs->queues[index], false);
+	for (int i = 1; !job && (i < jobs->thread_count); i++) {
+		job = Take(&jobs->queues[(index + i) % jobs->thread_count], true);
+	}
+	if (job) {
+		al_lock_mutex(jobs->mutex);
+		jobs->pending--;
+		al_unlock_mutex(jobs->mutex);
+	}
+	return job;
+}
+
+static void Complete(struct Jobs *jobs, struct Job *job) {
+	al_lock_mutex(jobs->mutex);
+	if (job->done) {
+		job->next = NULL;
+		if (jobs->completed_tail) {
+			jobs->completed_tail->next = job;
+		} else {
+			jobs->completed = job;
+		}
+		jobs->completed_tail = job;
+	} else {
+		jobs->unfinished--;
+		free(job);
+	}
+	al_broadcast_cond(jobs->done_cond);
+	al_unlock_mutex(jobs->mutex);
+}
+
+static void* WorkerThread(ALLEGRO_THREAD *thread, void *arg) {
+	struct Worker *worker = arg;
+	struct Jobs *jobs = worker->jobs;
+	al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+
+	while (true) {
+		al_lock_mutex(jobs->mutex);
+		unsigned int queued = jobs->queued;
+		al_unlock_mutex(jobs->mutex);
+		struct Job *job = TakeJob(jobs, worker->index);
+		if (job) {
+			job->work(job->arg);
+			Complete(jobs, job);
+			continue;
+		}
+		// Nothing left in any of the queues, but another worker may still be about to take it off the pending
+		// count, so it sleeps until something new gets queued rather than until nothing's pending.
+		al_lock_mutex(jobs->mutex);
+		while ((jobs->queued == queued) && !jobs->stop) {
+			al_wait_cond(jobs->work_cond, jobs->mutex);
+		}
+		bool stop = jobs->stop && (jobs->pending <= 0); // whatever was queued gets done before leaving
+		al_unlock_mutex(jobs->mutex);
+		if (stop) {
+			break;
+		}
+	}
+	return NULL;
+}
+
+struct Jobs* CreateJobs(int threads) {
+	struct Jobs *jobs = calloc(1, sizeof(struct Jobs));
+	jobs->mutex = al_create_mutex();
+	jobs->work_cond = al_create_cond();
+	jobs->done_cond = al_create_cond();
+	jobs->queues = calloc(threads, sizeof(struct JobQueue));
+	jobs->workers = calloc(threads, sizeof(struct Worker));
+	jobs->queue_count = threads;
+	for (int i = 0; i < threads; i++) {
+		jobs->queues[i].mutex = al_create_mutex();
+	}
+	for (int i = 0; i < threads; i++) {
+		struct Worker *worker = &jobs->workers[jobs->thread_count];
+		worker->jobs = jobs;
+		worker->index = jobs->thread_count;
+		worker->thread = al_create_thread(WorkerThread, worker);
+		if (worker->thread) {
+			jobs->thread_count++;
+		}
+	}
+	// started only once all of them exist, as they steal from each other's queues right away
+	for (int i = 0; i < jobs->thread_count; i++) {
+		al_start_thread(jobs->workers[i].thread);
+	}
+	return jobs;
+}
+
+void SubmitJob(struct Jobs *jobs, void (*work)(void *arg), void (*done)(struct Game *game, void *arg), void *arg) {
+	struct Job *job = calloc(1, sizeof(struct Job));
+	job->work = work;
+	job->done = done;
+	job->arg = arg;
+
+	al_lock_mutex(jobs->mutex);
+	jobs->unfinished++;
+	bool threaded = jobs->thread_count && !jobs->stop;
+	if (threaded) {
+		// queued and counted under the same lock the workers check before going to sleep
+		Push(&jobs->queues[jobs->next++ % jobs->thread_count], job);
+		jobs->pending++;
+		jobs->queued++;
+		al_signal_cond(jobs->work_cond);
+	}
+	al_unlock_mutex(jobs->mutex);
+
+	if (!threaded) {
+		job->work(job->arg);
+		Complete(jobs, job);
+	}
+}
+
+int RunJobCompletions(struct Game *game, struct Jobs *jobs) {
+	// Must be called from the display thread. Returns how many done() callbacks were called.
+	al_lock_mutex(jobs->mutex);
+	struct Job *job = jobs->completed;
+	jobs->completed = NULL;
+	jobs->completed_tail = NULL;
+	al_unlock_mutex(jobs->mutex);
+
+	int count = 0;
+	while (job) {
+		struct Job *next = job->next;
+		job->done(game, job->arg);
+		free(job);
+		job = next;
+		count++;
+	}
+
+	if (count) {
+		al_lock_mutex(jobs->mutex);
+		jobs->unfinished -= count;
+		al_broadcast_cond(jobs->done_cond);
+		al_unlock_mutex(jobs->mutex);
+	}
+	return count;
+}
+
+void FinishJobs(struct Game *game, struct Jobs *jobs) {
+	// Blocks until everything submitted so far is done and completed, e.g. before freeing what the jobs point to.
+	while (true) {
+		RunJobCompletions(game, jobs);
+		al_lock_mutex(jobs->mutex);
+		while (jobs->unfinished && !jobs->completed) {
+			al_wait_cond(jobs->done_cond, jobs->mutex);
+		}
+		bool finished = !jobs->unfinished;
+		al_unlock_mutex(jobs->mutex);
+		if (finished) {
+			return;
+		}
+	}
+}
+
+int GetJobThreadCount(struct Jobs *jobs) {
+	al_lock_mutex(jobs->mutex);
+	int count = jobs->stop ? 0 : jobs->thread_count;
+	al_unlock_mutex(jobs->mutex);
+	return count;
+}
+
+void StopJobs(struct Jobs *jobs) {
+	// Lets the workers finish what's queued and joins them, while Allegro is still around. Completions are
+	// kept for RunJobCompletions and anything submitted afterwards is done right away on the calling thread.
+	al_lock_mutex(jobs->mutex);
+	jobs->stop = true;
+	al_broadcast_cond(jobs->work_cond);
+	al_unlock_mutex(jobs->mutex);
+	for (int i = 0; i < jobs->thread_count; i++) {
+		al_join_thread(jobs->workers[i].thread, NULL);
+		al_destroy_thread(jobs->workers[i].thread);
+	}
+	al_lock_mutex(jobs->mutex);
+	jobs->thread_count = 0;
+	al_unlock_mutex(jobs->mutex);
+}
+
+void DestroyJobs(struct Jobs *jobs) {
+	StopJobs(jobs);
+	while (jobs->completed) {
+		// never completed, so whatever they hold is up to their submitters
+		struct Job *job = jobs->completed;
+		jobs->completed = job->next;
+		free(job);
+	}
+	for (int i = 0; i < jobs->queue_count; i++) {
+		al_destroy_mutex(jobs->queues[i].mutex);
+	}
+	free(jobs->queues);
+	free(jobs->workers);
+	al_destroy_cond(jobs->work_cond);
+	al_destroy_cond(jobs->done_cond);
+	al_destroy_mutex(jobs->mutex);
+	free(jobs);
+}
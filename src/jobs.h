@@ -0,0 +1,47 @@
+/*! \file jobs.h
+ *  \brief Background work shared by all gamestates.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLINDDATE_JOBS_H
+#define BLINDDATE_JOBS_H
+
+#include <stdbool.h>
+
+struct Game;
+
+/*! \brief Pool of worker threads, each with its own queue and stealing from the others when it runs dry.
+ *
+ * work() runs on a worker thread with memory bitmaps as the default, so it
+ * must not touch the display. done() is called later on the display thread by
+ * RunJobCompletions, which GlobalEventHandler does on every timer event, that
+ * is between the logic ticks; that's the place for anything that needs the GPU.
+ *
+ * Once the workers are stopped, or if none could be started, the work is done
+ * right away on the submitting thread and done() is still deferred. */
+struct Jobs;
+
+struct Jobs* CreateJobs(int threads);
+void SubmitJob(struct Jobs *jobs, void (*work)(void *arg), void (*done)(struct Game *game, void *arg), void *arg);
+int RunJobCompletions(struct Game *game, struct Jobs *jobs);
+void FinishJobs(struct Game *game, struct Jobs *jobs);
+int GetJobThreadCount(struct Jobs *jobs);
+void StopJobs(struct Jobs *jobs);
+void DestroyJobs(struct Jobs *jobs);
+
+#endif
@@ -0,0 +1,129 @@
+/*! \file latency.c
+ *  \brief Input-to-photon latency of the drawing.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "latency.h"
+
+#ifdef BLINDDATE_LATENCY
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define LATENCY_PENDING 256 // inputs per frame, far more than any device sends
+#define LATENCY_SAMPLES 65536
+
+enum {
+	PHASE_TOTAL, // from the input to the flip
+	PHASE_WAIT, // for the frame to start, which is mostly down to when the next one is scheduled
+	PHASE_DRAW, // from the start of the frame until it's drawn
+	PHASE_PRESENT, // from then until the flip is done
+	PHASE_COUNT
+};
+
+static const char *phase_names[PHASE_COUNT] = { "", "wait_", "draw_", "present_" };
+
+// all of it is only touched from the display thread
+static double pending[LATENCY_PENDING]; // inputs not drawn yet
+static double drawn[LATENCY_PENDING]; // drawn, waiting for the flip
+static int pending_count, drawn_count;
+static double frame_time, drawn_time; // when the last frame was started and finished drawing
+static double samples[PHASE_COUNT][LATENCY_SAMPLES];
+static int sample_count, dropped;
+
+void LatencyInput(double timestamp) {
+	if (pending_count < LATENCY_PENDING) {
+		pending[pending_count++] = timestamp;
+	} else {
+		dropped++;
+	}
+}
+
+void LatencyFrame(double time) {
+	frame_time = time;
+}
+
+void LatencyDrawn(double time) {
+	for (int i = 0; i < pending_count; i++) {
+		if (drawn_count < LATENCY_PENDING) {
+			drawn[drawn_count++] = pending[i];
+		} else {
+			dropped++;
+		}
+	}
+	pending_count = 0;
+	drawn_time = time;
+}
+
+void LatencyShown(double time) {
+	for (int i = 0; i < drawn_count; i++) {
+		if (sample_count < LATENCY_SAMPLES) {
+			// an input that came in after the frame was started by the clock is taken to have waited for nothing
+			double start = (frame_time > drawn[i]) ? frame_time : drawn[i];
+			samples[PHASE_TOTAL][sample_count] = time - drawn[i];
+			samples[PHASE_WAIT][sample_count] = start - drawn[i];
+			samples[PHASE_DRAW][sample_count] = drawn_time - start;
+			samples[PHASE_PRESENT][sample_count] = time - drawn_time;
+			sample_count++;
+		} else {
+			dropped++;
+		}
+	}
+	drawn_count = 0;
+}
+
+static int CompareDoubles(const void *a, const void *b) {
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+static double Percentile(int phase, int p) {
+	// nearest rank
+	int rank = (p * sample_count + 99) / 100;
+	return samples[phase][(rank > 0) ? (rank - 1) : 0] * 1000;
+}
+
+void LatencyWrite(const char *filename) {
+	FILE *file = fopen(filename, "w");
+	if (!file) {
+		fprintf(stderr, "Could not write latency report to %s!\n", filename);
+		return;
+	}
+	fprintf(file, "{\n\t\"samples\": %d,\n\t\"dropped\": %d", sample_count, dropped);
+	for (int phase = 0; phase < PHASE_COUNT; phase++) {
+		qsort(samples[phase], sample_count, sizeof(double), CompareDoubles);
+		if (sample_count) {
+			const char *name = phase_names[phase];
+			fprintf(file, ",\n\t\"%sp50_ms\": %.3f,\n\t\"%sp95_ms\": %.3f,\n\t\"%sp99_ms\": %.3f,\n\t\"%smax_ms\": %.3f",
+			        name, Percentile(phase, 50), name, Percentile(phase, 95), name, Percentile(phase, 99),
+			        name, samples[phase][sample_count - 1] * 1000);
+		}
+	}
+	fprintf(file, "\n}\n");
+	fclose(file);
+	if (sample_count) {
+		fprintf(stderr, "Input latency of %d inputs: p50 %.1f ms, p95 %.1f ms, p99 %.1f ms; written to %s.\n",
+		        sample_count, Percentile(PHASE_TOTAL, 50), Percentile(PHASE_TOTAL, 95), Percentile(PHASE_TOTAL, 99), filename);
+		fprintf(stderr, "Medians of its parts: %.1f ms waiting for the frame, %.1f ms drawing it, %.1f ms until it was shown.\n",
+		        Percentile(PHASE_WAIT, 50), Percentile(PHASE_DRAW, 50), Percentile(PHASE_PRESENT, 50));
+	} else {
+		fprintf(stderr, "No input latency recorded, empty report written to %s.\n", filename);
+	}
+}
+
+#endif
@@ -0,0 +1,60 @@
+/*! \file latency.h
+ *  \brief Input-to-photon latency of the drawing.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLINDDATE_LATENCY_H
+#define BLINDDATE_LATENCY_H
+
+/* Compiled in only with the BLINDDATE_LATENCY CMake option, like the tracing.
+ *
+ * Every input that changes what's drawn is recorded with LATENCY_INPUT and the
+ * timestamp Allegro gave its event on arrival. LATENCY_FRAME and LATENCY_DRAWN
+ * mark the start and the end of drawing the frame that shows all of them, and
+ * LATENCY_SHOWN the moment the next flip is done. The flip is caught right at
+ * al_flip_display, by static.c in the static build and by interpose.c
+ * otherwise; on Windows, where neither is built, it's taken to be when the
+ * next event gets handled, which can only come after it. LATENCY_WRITE saves
+ * the percentiles of the whole and of each part: waiting for the frame to
+ * start, drawing it and getting it shown. */
+
+#ifdef BLINDDATE_LATENCY
+
+void LatencyInput(double timestamp);
+void LatencyFrame(double time);
+void LatencyDrawn(double time);
+void LatencyShown(double time);
+void LatencyWrite(const char *filename);
+
+#define LATENCY_INPUT(timestamp) LatencyInput(timestamp)
+#define LATENCY_FRAME(time) LatencyFrame(time)
+#define LATENCY_DRAWN(time) LatencyDrawn(time)
+#define LATENCY_SHOWN(time) LatencyShown(time)
+#define LATENCY_WRITE(filename) LatencyWrite(filename)
+
+#else
+
+#define LATENCY_INPUT(timestamp) ((void)0)
+#define LATENCY_FRAME(time) ((void)0)
+#define LATENCY_DRAWN(time) ((void)0)
+#define LATENCY_SHOWN(time) ((void)0)
+#define LATENCY_WRITE(filename) ((void)0)
+
+#endif
+
+#endif
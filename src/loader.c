@@ -0,0 +1,255 @@
+/*! \file loader.c
+ *  \brief Background asset decoding.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <allegro5/allegro_audio.h>
+#include <allegro5/allegro_font.h>
+#include "jobs.h"
+#include "loader.h"
+#include "quality.h"
+#include "trace.h"
+
+enum LoaderJobState {
+	LOADER_JOB_PENDING,
+	LOADER_JOB_RUNNING,
+	LOADER_JOB_DONE
+};
+
+struct Loader {
+		struct Jobs *workers; // where the decoding happens
+		const struct Quality *quality;
+		ALLEGRO_MUTEX *mutex; // may be held while asking the workers for their thread count, but never while submitting to them
+		ALLEGRO_COND *done_cond;
+		struct LoaderJob *jobs, *tail; // in the order they were added
+		int busy; // pending and running jobs
+		int outstanding; // claimed jobs not yet handed back by WaitForLoaderJob
+		bool stop;
+};
+
+static void Unlink(struct Loader *loader, struct LoaderJob *job) {
+	struct LoaderJob **tmp = &loader->jobs;
+	struct LoaderJob *prev = NULL;
+	while (*tmp != job) {
+		prev = *tmp;
+		tmp = &(*tmp)->next;
+	}
+	*tmp = job->next;
+	if (loader->tail == job) {
+		loader->tail = prev;
+	}
+	job->next = NULL;
+}
+
+static void RunLoaderJob(void *arg) {
+	struct LoaderJob *job = arg;
+	struct Loader *loader = job->loader;
+	al_lock_mutex(loader->mutex);
+	job->state = LOADER_JOB_RUNNING;
+	al_unlock_mutex(loader->mutex);
+
+	TRACE_BEGIN_ARG("decode", job->path);
+	job->work(job);
+	TRACE_END();
+
+	al_lock_mutex(loader->mutex);
+	job->state = LOADER_JOB_DONE;
+	loader->busy--;
+	al_broadcast_cond(loader->done_cond);
+	al_unlock_mutex(loader->mutex);
+}
+
+struct Loader* CreateLoader(struct Jobs *jobs, const struct Quality *quality) {
+	struct Loader *loader = calloc(1, sizeof(struct Loader));
+	loader->workers = jobs;
+	loader->quality = quality;
+	loader->mutex = al_create_mutex();
+	loader->done_cond = al_create_cond();
+	return loader;
+}
+
+static struct LoaderJob* AddJob(struct Loader *loader, void (*work)(struct LoaderJob*), char *path, int param, bool *submit) {
+	// Called with the mutex held; when *submit is set, the job has to be submitted once it's released.
+	struct LoaderJob *job = calloc(1, sizeof(struct LoaderJob));
+	job->work = work;
+	job->path = path ? strdup(path) : NULL;
+	job->param = param;
+	job->loader = loader;
+	job->quality = loader->quality;
+
+	if (loader->tail) {
+		loader->tail->next = job;
+	} else {
+		loader->jobs = job;
+	}
+	loader->tail = job;
+
+	*submit = !loader->stop && GetJobThreadCount(loader->workers);
+	if (*submit) {
+		loader->busy++; // so StopLoader waits for it, even before it's submitted
+	} else {
+		// no threads available, so do it right away
+		job->work(job);
+		job->state = LOADER_JOB_DONE;
+	}
+	return job;
+}
+
+static void SubmitLoaderJob(struct Loader *loader, struct LoaderJob *job) {
+	// No completion callback; it's handed back by WaitForLoaderJob and PollLoaderJob instead. Should the workers
+	// have stopped in the meantime, it's done right here, and RunLoaderJob takes the mutex by itself.
+	SubmitJob(loader->workers, RunLoaderJob, NULL, job);
+}
+
+void PreloadLoaderJob(struct Loader *loader, void (*work)(struct LoaderJob*), char *path, int param) {
+	bool submit;
+	al_lock_mutex(loader->mutex);
+	struct LoaderJob *job = AddJob(loader, work, path, param, &submit);
+	al_unlock_mutex(loader->mutex);
+	if (submit) {
+		SubmitLoaderJob(loader, job);
+	}
+}
+
+struct LoaderJob* AddLoaderJob(struct Loader *loader, void (*work)(struct LoaderJob*), char *path, int param, void *data) {
+	// Claims an unclaimed job for the same work if there's one (because it was preloaded), or adds a new one.
+	bool submit = false;
+	al_lock_mutex(loader->mutex);
+	struct LoaderJob *job;
+	for (job = loader->jobs; job; job = job->next) {
+		if (!job->claimed && (job->work == work) && (job->param == param) &&
+		    ((job->path == path) || (job->path && path && !strcmp(job->path, path)))) {
+			break;
+		}
+	}
+	if (!job) {
+		job = AddJob(loader, work, path, param, &submit);
+	}
+	job->claimed = true;
+	job->data = data;
+	loader->outstanding++;
+	al_unlock_mutex(loader->mutex);
+	if (submit) {
+		SubmitLoaderJob(loader, job);
+	}
+	return job;
+}
+
+static struct LoaderJob* TakeDoneJob(struct Loader *loader) {
+	struct LoaderJob *job;
+	for (job = loader->jobs; job && (!job->claimed || (job->state != LOADER_JOB_DONE)); job = job->next);
+	if (job) {
+		Unlink(loader, job);
+		loader->outstanding--;
+	}
+	return job;
+}
+
+struct LoaderJob* WaitForLoaderJob(struct Loader *loader) {
+	// Blocks until any claimed job is finished and returns it, or returns NULL once every one has been handed back.
+	al_lock_mutex(loader->mutex);
+	struct LoaderJob *job = NULL;
+	while (loader->outstanding) {
+		job = TakeDoneJob(loader);
+		if (job) {
+			break;
+		}
+		al_wait_cond(loader->done_cond, loader->mutex);
+	}
+	al_unlock_mutex(loader->mutex);
+	return job;
+}
+
+struct LoaderJob* PollLoaderJob(struct Loader *loader) {
+	// Like WaitForLoaderJob, but returns NULL right away when no claimed job is finished yet.
+	al_lock_mutex(loader->mutex);
+	struct LoaderJob *job = TakeDoneJob(loader);
+	al_unlock_mutex(loader->mutex);
+	return job;
+}
+
+bool IsLoaderBusy(struct Loader *loader) {
+	al_lock_mutex(loader->mutex);
+	bool busy = loader->busy;
+	al_unlock_mutex(loader->mutex);
+	return busy;
+}
+
+void DestroyLoaderJob(struct LoaderJob *job) {
+	free(job->path);
+	free(job);
+}
+
+static void DiscardLoaderJob(struct LoaderJob *job) {
+	// nobody claimed it; every job produces a bitmap, except for the audio streams and fonts
+	if (job->result) {
+		if (job->work == LoadAudioStreamWork) {
+			al_destroy_audio_stream(job->result);
+		} else if (job->work == LoadFontWork) {
+			al_destroy_font(job->result);
+		} else {
+			al_destroy_bitmap(job->result);
+		}
+	}
+	DestroyLoaderJob(job);
+}
+
+void StopLoader(struct Loader *loader) {
+	// Finishes every job, while Allegro is still around. Claimed jobs are kept for WaitForLoaderJob
+	// and anything added afterwards gets done right away on the calling thread.
+	al_lock_mutex(loader->mutex);
+	while (loader->busy) {
+		al_wait_cond(loader->done_cond, loader->mutex);
+	}
+	loader->stop = true;
+	al_unlock_mutex(loader->mutex);
+
+	struct LoaderJob *job = loader->jobs;
+	while (job) {
+		struct LoaderJob *next = job->next;
+		if (!job->claimed) {
+			Unlink(loader, job);
+			DiscardLoaderJob(job);
+		}
+		job = next;
+	}
+}
+
+void DestroyLoader(struct Loader *loader) {
+	StopLoader(loader);
+	al_destroy_cond(loader->done_cond);
+	al_destroy_mutex(loader->mutex);
+	free(loader);
+}
+
+void LoadMemoryBitmapWork(struct LoaderJob *job) {
+	job->result = al_load_bitmap(job->path);
+}
+
+void LoadAudioStreamWork(struct LoaderJob *job) {
+	job->result = al_load_audio_stream(job->path, job->quality->stream_buffers, job->quality->stream_samples);
+}
+
+void LoadFontWork(struct LoaderJob *job) {
+	// TTF glyphs are only rendered once drawn, on the display thread, into pages made with the flags set here
+	al_set_new_bitmap_flags(job->quality->bitmap_flags);
+	job->result = al_load_font(job->path, job->param, 0);
+	al_set_new_bitmap_flags(ALLEGRO_MEMORY_BITMAP);
+}
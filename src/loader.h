@@ -0,0 +1,63 @@
+/*! \file loader.h
+ *  \brief Background asset decoding.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLINDDATE_LOADER_H
+#define BLINDDATE_LOADER_H
+
+#include <allegro5/allegro.h>
+
+/*! \brief Single piece of work for the loader.
+ *
+ * work() runs on a worker thread of the shared Jobs, where no display is
+ * current, so it may only produce memory bitmaps. Whatever needs the GPU has to
+ * be done after the job is handed back to the display thread by WaitForLoaderJob. */
+struct LoaderJob {
+		void (*work)(struct LoaderJob *job);
+		char *path; /*!< Resolved file path, owned by the job. */
+		int param;
+		void *result;
+		void *data; /*!< For use by whoever claimed the job. */
+		const struct Quality *quality; /*!< What to decode the assets at; the same for every job. */
+
+		int state;
+		bool claimed;
+		struct Loader *loader;
+		struct LoaderJob *next;
+};
+
+struct Loader;
+struct Jobs;
+struct Quality;
+
+struct Loader* CreateLoader(struct Jobs *jobs, const struct Quality *quality);
+void PreloadLoaderJob(struct Loader *loader, void (*work)(struct LoaderJob*), char *path, int param);
+struct LoaderJob* AddLoaderJob(struct Loader *loader, void (*work)(struct LoaderJob*), char *path, int param, void *data);
+struct LoaderJob* WaitForLoaderJob(struct Loader *loader);
+struct LoaderJob* PollLoaderJob(struct Loader *loader);
+bool IsLoaderBusy(struct Loader *loader);
+void DestroyLoaderJob(struct LoaderJob *job);
+void StopLoader(struct Loader *loader);
+void DestroyLoader(struct Loader *loader);
+
+void LoadMemoryBitmapWork(struct LoaderJob *job);
+void LoadAudioStreamWork(struct LoaderJob *job);
+void LoadFontWork(struct LoaderJob *job);
+
+#endif
@@ -37,23 +37,33 @@ int main(int argc, char** argv) {
 	al_set_org_name("dosowisko.net");
 	al_set_app_name(LIBSUPERDERPY_GAMENAME_PRETTY);
 
+	TRACE_BEGIN("libsuperderpy_init");
 	struct Game *game = libsuperderpy_init(argc, argv, LIBSUPERDERPY_GAMENAME, (struct Viewport){.aspect=320/180.0});
+	TRACE_END();
 	if (!game) { return 1; }
 
 	al_set_window_title(game->display, LIBSUPERDERPY_GAMENAME_PRETTY);
 
-	LoadGamestate(game, "dosowisko");
+	game->data = CreateGameData(game);
+
+	LoadGamestate(game, "dosowisko"); // only queued, libsuperderpy_run does the loading
 	StartGamestate(game, "dosowisko");
 
-	game->data = CreateGameData(game);
+	PreloadDate(game);
 
 	game->eventHandler = &GlobalEventHandler;
 
 	libsuperderpy_run(game);
 
-	DestroyGameData(game, game->data);
+	struct CommonResources *data = game->data;
+	StopGameData(game, data);
 
 	libsuperderpy_destroy(game);
 
+	DestroyGameData(data);
+
+	TRACE_WRITE(LIBSUPERDERPY_GAMENAME "-trace.json");
+	LATENCY_WRITE(LIBSUPERDERPY_GAMENAME "-latency.json");
+
 	return 0;
 }
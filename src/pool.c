@@ -0,0 +1,84 @@
+/*! \file pool.c
+ *  \brief Fixed-size object pool.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include "pool.h"
+
+static bool InArena(struct Pool *pool, void *ptr) {
+	return ((char*)ptr >= pool->arena) && ((char*)ptr < pool->arena + pool->size * pool->count);
+}
+
+struct Pool* CreatePool(size_t size, int count) {
+	struct Pool *pool = calloc(1, sizeof(struct Pool));
+	// every slot has to be able to hold the free list link
+	pool->size = (size < sizeof(void*)) ? sizeof(void*) : size;
+	pool->size = (pool->size + sizeof(void*) - 1) / sizeof(void*) * sizeof(void*);
+	pool->count = count;
+	pool->arena = malloc(pool->size * count);
+	pool->mallocs = 1;
+	PoolReset(pool);
+	return pool;
+}
+
+void* PoolAlloc(struct Pool *pool) {
+	void *ptr = pool->free;
+	if (ptr) {
+		pool->free = *(void**)ptr;
+	} else {
+		ptr = malloc(pool->size);
+		pool->mallocs++;
+		pool->overflow++;
+	}
+	pool->used++;
+	if (pool->used > pool->peak) {
+		pool->peak = pool->used;
+	}
+	return ptr;
+}
+
+void PoolFree(struct Pool *pool, void *ptr) {
+	if (!ptr) {
+		return;
+	}
+	pool->used--;
+	if (!InArena(pool, ptr)) {
+		pool->overflow--;
+		free(ptr);
+		return;
+	}
+	*(void**)ptr = pool->free;
+	pool->free = ptr;
+}
+
+void PoolReset(struct Pool *pool) {
+	// Reclaims every arena slot at once; slots allocated past the arena still have to be freed with PoolFree.
+	pool->free = NULL;
+	for (int i = pool->count - 1; i >= 0; i--) {
+		void *slot = pool->arena + i * pool->size;
+		*(void**)slot = pool->free;
+		pool->free = slot;
+	}
+	pool->used = pool->overflow;
+}
+
+void DestroyPool(struct Pool *pool) {
+	free(pool->arena);
+	free(pool);
+}
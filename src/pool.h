@@ -0,0 +1,48 @@
+/*! \file pool.h
+ *  \brief Fixed-size object pool.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLINDDATE_POOL_H
+#define BLINDDATE_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*! \brief Arena of equally sized slots chained into a free list.
+ *
+ * When the arena runs out, slots are malloc'd one by one and counted in
+ * mallocs, so a pool sized for the workload stays at a single allocation. */
+struct Pool {
+		char *arena;
+		size_t size; /*!< Slot size in bytes. */
+		int count; /*!< Number of slots in the arena. */
+		void *free;
+
+		int used, peak;
+		int overflow; /*!< Slots currently allocated outside of the arena. */
+		int mallocs; /*!< Allocations made since creation, including the arena itself. */
+};
+
+struct Pool* CreatePool(size_t size, int count);
+void* PoolAlloc(struct Pool *pool);
+void PoolFree(struct Pool *pool, void *ptr);
+void PoolReset(struct Pool *pool);
+void DestroyPool(struct Pool *pool);
+
+#endif
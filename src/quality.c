@@ -0,0 +1,93 @@
+/*! \file quality.c
+ *  \brief Quality presets read from the config file.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <libsuperderpy.h>
+#include "quality.h"
+
+static const struct Quality presets[] = {
+	// low: a quarter of the light map, half the sprite resolution and fewer stream refills
+	{ "low", 4, 2, 4, 2048, 0 },
+	{ "medium", 2, 1, 4, 1024, ALLEGRO_MIN_LINEAR | ALLEGRO_MAG_LINEAR },
+	{ "high", 1, 1, 4, 1024, ALLEGRO_MIN_LINEAR | ALLEGRO_MAG_LINEAR }
+};
+
+static const char *filterings[] = { "nearest", "linear", "mipmap" };
+static const int filtering_flags[] = { 0, ALLEGRO_MIN_LINEAR | ALLEGRO_MAG_LINEAR, ALLEGRO_MIN_LINEAR | ALLEGRO_MAG_LINEAR | ALLEGRO_MIPMAP };
+
+static void OverrideInt(struct Game *game, char *key, int *value, int min, int max) {
+	char *option = GetConfigOption(game, "BlindDate", key);
+	if (option) {
+		int v = atoi(option);
+		if ((v >= min) && (v <= max)) {
+			*value = v;
+		} else {
+			PrintConsole(game, "Ignoring %s=%s, it has to be between %d and %d.", key, option, min, max);
+		}
+	}
+	free(option);
+}
+
+static const char* GetFiltering(int flags) {
+	for (size_t i = 0; i < sizeof(filterings) / sizeof(filterings[0]); i++) {
+		if (filtering_flags[i] == flags) {
+			return filterings[i];
+		}
+	}
+	return "custom";
+}
+
+void LoadQuality(struct Game *game, struct Quality *quality) {
+	*quality = presets[2];
+	char *preset = GetConfigOption(game, "BlindDate", "quality");
+	if (preset) {
+		size_t i;
+		for (i = 0; (i < sizeof(presets) / sizeof(presets[0])) && strcmp(presets[i].preset, preset); i++);
+		if (i < sizeof(presets) / sizeof(presets[0])) {
+			*quality = presets[i];
+		} else {
+			PrintConsole(game, "Unknown quality preset %s, using %s.", preset, quality->preset);
+		}
+	}
+	free(preset);
+
+	OverrideInt(game, "light_scale", &quality->light_scale, 1, 16);
+	OverrideInt(game, "sprite_scale", &quality->sprite_scale, 1, 4);
+	OverrideInt(game, "stream_buffers", &quality->stream_buffers, 2, 16);
+	OverrideInt(game, "stream_samples", &quality->stream_samples, 256, 16384);
+
+	char *filtering = GetConfigOption(game, "BlindDate", "filtering");
+	if (filtering) {
+		size_t i;
+		for (i = 0; (i < sizeof(filterings) / sizeof(filterings[0])) && strcmp(filterings[i], filtering); i++);
+		if (i < sizeof(filterings) / sizeof(filterings[0])) {
+			quality->bitmap_flags = filtering_flags[i];
+		} else {
+			PrintConsole(game, "Unknown filtering %s, using %s.", filtering, GetFiltering(quality->bitmap_flags));
+		}
+	}
+	free(filtering);
+
+	PrintConsole(game, "Quality %s: lights at 1/%d, sprites at 1/%d, %d stream buffers of %d samples, %s filtering.",
+	             quality->preset, quality->light_scale, quality->sprite_scale, quality->stream_buffers,
+	             quality->stream_samples, GetFiltering(quality->bitmap_flags));
+}
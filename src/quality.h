@@ -0,0 +1,48 @@
+/*! \file quality.h
+ *  \brief Quality presets read from the config file.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLINDDATE_QUALITY_H
+#define BLINDDATE_QUALITY_H
+
+struct Game;
+
+/*! \brief Performance-relevant settings, read once at startup.
+ *
+ * Picked with "quality" (low, medium or high; high by default) in the
+ * [BlindDate] section of the config file, where each of the values below can
+ * also be overridden on its own under the same name.
+ *
+ * The drawing canvas isn't among them. Its pixels are the unit everything
+ * about a drawing is measured in: the stroke segments, the symbols and their
+ * distance fields, the meter's grid, and the stroke radius and tolerances the
+ * scores are worked out with. The raster score, which the dialogue's
+ * thresholds are tuned for, compares it with the symbols pixel by pixel. */
+struct Quality {
+		const char *preset;
+		int light_scale; /*!< Light maps are generated at this fraction of the canvas resolution. */
+		int sprite_scale; /*!< Sprites are downscaled by this much once decoded, and drawn scaled back up. */
+		int stream_buffers; /*!< Of every audio stream. */
+		int stream_samples; /*!< Per buffer of every audio stream. */
+		int bitmap_flags; /*!< Filtering of the bitmaps that get drawn scaled; "filtering" is nearest, linear or mipmap. */
+};
+
+void LoadQuality(struct Game *game, struct Quality *quality);
+
+#endif
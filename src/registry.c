@@ -0,0 +1,336 @@
+/*! \file registry.c
+ *  \brief Accounting of the memory held by assets.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include <stdio.h>
+#include <string.h>
+#include "common.h"
+#include <libsuperderpy.h>
+
+#define MiB(bytes) ((bytes) / (1024.0 * 1024.0))
+
+struct Registry* CreateRegistry(bool dump) {
+	struct Registry *registry = calloc(1, sizeof(struct Registry));
+	registry->total.owner = "total";
+	registry->dump = dump;
+	return registry;
+}
+
+static struct Registry* GetRegistry(struct Game *game) {
+	// the loading screen may be loaded before the game data exists
+	return game->data ? game->data->registry : NULL;
+}
+
+static struct AssetOwner* GetOwner(struct Registry *registry, const char *owner) {
+	struct AssetOwner *tmp;
+	for (tmp = registry->owners; tmp; tmp = tmp->next) {
+		if (!strcmp(tmp->owner, owner)) {
+			return tmp;
+		}
+	}
+	tmp = calloc(1, sizeof(struct AssetOwner));
+	tmp->owner = owner;
+	tmp->next = registry->owners;
+	registry->owners = tmp;
+	return tmp;
+}
+
+static void Account(struct AssetOwner *owner, struct Asset *asset, int sign) {
+	owner->count += sign;
+	if (asset->vram) {
+		owner->vram += sign * asset->bytes;
+	} else {
+		owner->ram += sign * asset->bytes;
+	}
+	if (owner->ram > owner->peak_ram) {
+		owner->peak_ram = owner->ram;
+	}
+	if (owner->vram > owner->peak_vram) {
+		owner->peak_vram = owner->vram;
+	}
+}
+
+static void Track(struct Game *game, const char *owner, const char *kind, const char *name, void *ptr, size_t bytes, bool vram) {
+	struct Registry *registry = GetRegistry(game);
+	if (!registry || !ptr) {
+		return;
+	}
+	struct Asset *asset = calloc(1, sizeof(struct Asset));
+	asset->ptr = ptr;
+	asset->owner = owner;
+	asset->kind = kind;
+	size_t len = strlen(name);
+	strncpy(asset->name, (len < sizeof(asset->name)) ? name : name + len - sizeof(asset->name) + 1, sizeof(asset->name) - 1);
+	asset->bytes = bytes;
+	asset->vram = vram;
+	asset->next = registry->assets;
+	registry->assets = asset;
+	Account(GetOwner(registry, owner), asset, 1);
+	Account(&registry->total, asset, 1);
+}
+
+ALLEGRO_BITMAP* TrackBitmap(struct Game *game, const char *owner, const char *name, ALLEGRO_BITMAP *bitmap) {
+	if (bitmap) {
+		size_t bytes = al_get_bitmap_width(bitmap) * al_get_bitmap_height(bitmap) * al_get_pixel_size(al_get_bitmap_format(bitmap));
+		Track(game, owner, "bitmap", name, bitmap, bytes, !(al_get_bitmap_flags(bitmap) & ALLEGRO_MEMORY_BITMAP));
+	}
+	return bitmap;
+}
+
+ALLEGRO_FONT* TrackFont(struct Game *game, const char *owner, char *filename, ALLEGRO_FONT *font) {
+	// Only the font file is counted; glyphs get rendered into cache pages on demand.
+	if (font) {
+		ALLEGRO_FILE *file = al_fopen(GetDataFilePath(game, filename), "rb");
+		size_t bytes = 0;
+		if (file) {
+			bytes = al_fsize(file);
+			al_fclose(file);
+		}
+		Track(game, owner, "font", filename, font, bytes, false);
+	}
+	return font;
+}
+
+ALLEGRO_SAMPLE* TrackSample(struct Game *game, const char *owner, const char *name, ALLEGRO_SAMPLE *sample) {
+	if (sample) {
+		size_t bytes = al_get_sample_length(sample) * al_get_channel_count(al_get_sample_channels(sample)) * al_get_audio_depth_size(al_get_sample_depth(sample));
+		Track(game, owner, "sample", name, sample, bytes, false);
+	}
+	return sample;
+}
+
+ALLEGRO_AUDIO_STREAM* TrackStream(struct Game *game, const char *owner, const char *name, ALLEGRO_AUDIO_STREAM *stream) {
+	// streams only hold their fragment buffers, however long they are
+	if (stream) {
+		size_t bytes = al_get_audio_stream_fragments(stream) * al_get_audio_stream_length(stream) *
+		               al_get_channel_count(al_get_audio_stream_channels(stream)) * al_get_audio_depth_size(al_get_audio_stream_depth(stream));
+		Track(game, owner, "stream", name, stream, bytes, false);
+	}
+	return stream;
+}
+
+static struct Asset* FindAsset(struct Registry *registry, void *ptr) {
+	for (struct Asset *asset = registry->assets; asset; asset = asset->next) {
+		if (asset->ptr == ptr) {
+			return asset;
+		}
+	}
+	return NULL;
+}
+
+void ShareAsset(struct Game *game, const char *owner, void *ptr) {
+	// Counts a registered asset towards one more owner as long as it holds a reference to it,
+	// so that it shows up in its totals and as its leak if it never lets go.
+	struct Registry *registry = GetRegistry(game);
+	if (!registry || !ptr) {
+		return;
+	}
+	for (struct AssetShare *share = registry->shares; share; share = share->next) {
+		if ((share->ptr == ptr) && !strcmp(share->owner, owner)) {
+			share->refs++;
+			return;
+		}
+	}
+	struct Asset *asset = FindAsset(registry, ptr);
+	if (!asset) {
+		return;
+	}
+	struct AssetShare *share = calloc(1, sizeof(struct AssetShare));
+	share->ptr = ptr;
+	share->owner = owner;
+	share->refs = 1;
+	share->next = registry->shares;
+	registry->shares = share;
+	Account(GetOwner(registry, owner), asset, 1);
+}
+
+static void RemoveShare(struct Registry *registry, struct AssetShare **share) {
+	struct AssetShare *tmp = *share;
+	*share = tmp->next;
+	struct Asset *asset = FindAsset(registry, tmp->ptr);
+	if (asset) {
+		Account(GetOwner(registry, tmp->owner), asset, -1);
+	}
+	free(tmp);
+}
+
+void UnshareAsset(struct Game *game, const char *owner, void *ptr) {
+	struct Registry *registry = GetRegistry(game);
+	if (!registry || !ptr) {
+		return;
+	}
+	for (struct AssetShare **tmp = &registry->shares; *tmp; tmp = &(*tmp)->next) {
+		if (((*tmp)->ptr == ptr) && !strcmp((*tmp)->owner, owner)) {
+			if (--(*tmp)->refs == 0) {
+				RemoveShare(registry, tmp);
+			}
+			return;
+		}
+	}
+}
+
+void UntrackAsset(struct Game *game, void *ptr) {
+	struct Registry *registry = GetRegistry(game);
+	if (!registry || !ptr) {
+		return;
+	}
+	// whoever still shares it is left with a dangling reference, which CheckAssetLeaks has reported already
+	for (struct AssetShare **tmp = &registry->shares; *tmp;) {
+		if ((*tmp)->ptr == ptr) {
+			RemoveShare(registry, tmp);
+		} else {
+			tmp = &(*tmp)->next;
+		}
+	}
+	for (struct Asset **tmp = &registry->assets; *tmp; tmp = &(*tmp)->next) {
+		struct Asset *asset = *tmp;
+		if (asset->ptr == ptr) {
+			*tmp = asset->next;
+			Account(GetOwner(registry, asset->owner), asset, -1);
+			Account(&registry->total, asset, -1);
+			free(asset);
+			return;
+		}
+	}
+}
+
+void DestroyTrackedBitmap(struct Game *game, ALLEGRO_BITMAP *bitmap) {
+	UntrackAsset(game, bitmap);
+	al_destroy_bitmap(bitmap);
+}
+
+void DestroyTrackedFont(struct Game *game, ALLEGRO_FONT *font) {
+	UntrackAsset(game, font);
+	al_destroy_font(font);
+}
+
+void DestroyTrackedSample(struct Game *game, ALLEGRO_SAMPLE *sample) {
+	UntrackAsset(game, sample);
+	al_destroy_sample(sample);
+}
+
+void DestroyTrackedStream(struct Game *game, ALLEGRO_AUDIO_STREAM *stream) {
+	UntrackAsset(game, stream);
+	al_destroy_audio_stream(stream);
+}
+
+size_t GetAssetBytes(struct Game *game, void *ptr) {
+	struct Registry *registry = GetRegistry(game);
+	if (!registry) {
+		return 0;
+	}
+	struct Asset *asset = FindAsset(registry, ptr);
+	return asset ? asset->bytes : 0;
+}
+
+int CountAssets(struct Game *game, const char *owner, const char *kind) {
+	// NULL owner or kind counts them all
+	struct Registry *registry = GetRegistry(game);
+	if (!registry) {
+		return 0;
+	}
+	int count = 0;
+	for (struct Asset *asset = registry->assets; asset; asset = asset->next) {
+		count += (!owner || !strcmp(asset->owner, owner)) && (!kind || !strcmp(asset->kind, kind));
+	}
+	return count;
+}
+
+void ReportAssets(struct Game *game, const char *owner) {
+	struct Registry *registry = GetRegistry(game);
+	if (!registry) {
+		return;
+	}
+	struct AssetOwner *tmp = GetOwner(registry, owner);
+	PrintConsole(game, "%s: %d assets, %.2f MiB RAM (peak %.2f), %.2f MiB VRAM (peak %.2f)", owner, tmp->count,
+	             MiB(tmp->ram), MiB(tmp->peak_ram), MiB(tmp->vram), MiB(tmp->peak_vram));
+	tmp = &registry->total;
+	PrintConsole(game, "All gamestates: %d assets, %.2f MiB RAM (peak %.2f), %.2f MiB VRAM (peak %.2f)", tmp->count,
+	             MiB(tmp->ram), MiB(tmp->peak_ram), MiB(tmp->vram), MiB(tmp->peak_vram));
+}
+
+void CheckAssetLeaks(struct Game *game, const char *owner) {
+	// Called at the very end of Gamestate_Unload, so everything the owner registered should be gone by now.
+	struct Registry *registry = GetRegistry(game);
+	if (!registry) {
+		return;
+	}
+	for (struct Asset *asset = registry->assets; asset; asset = asset->next) {
+		if (!strcmp(asset->owner, owner)) {
+			PrintConsole(game, "LEAK: %s %s %s (%.2f MiB) is still registered after unload!", owner, asset->kind, asset->name, MiB(asset->bytes));
+		}
+	}
+	for (struct AssetShare *share = registry->shares; share; share = share->next) {
+		if (!strcmp(share->owner, owner)) {
+			struct Asset *asset = FindAsset(registry, share->ptr);
+			PrintConsole(game, "LEAK: %s still holds %d references to %s %s (%.2f MiB) after unload!", owner, share->refs,
+			             asset->kind, asset->name, MiB(asset->bytes));
+		}
+	}
+}
+
+static void Dump(struct Registry *registry, const char *filename) {
+	FILE *file = fopen(filename, "w");
+	if (!file) {
+		fprintf(stderr, "Could not write asset report to %s!\n", filename);
+		return;
+	}
+	fprintf(file, "%-16s %6s %12s %12s %12s %12s\n", "owner", "assets", "RAM", "peak RAM", "VRAM", "peak VRAM");
+	for (struct AssetOwner *tmp = registry->owners; tmp; tmp = tmp->next) {
+		fprintf(file, "%-16s %6d %12zu %12zu %12zu %12zu\n", tmp->owner, tmp->count, tmp->ram, tmp->peak_ram, tmp->vram, tmp->peak_vram);
+	}
+	struct AssetOwner *total = &registry->total;
+	fprintf(file, "%-16s %6d %12zu %12zu %12zu %12zu\n", total->owner, total->count, total->ram, total->peak_ram, total->vram, total->peak_vram);
+
+	fprintf(file, "\nleaked:\n");
+	for (struct Asset *asset = registry->assets; asset; asset = asset->next) {
+		fprintf(file, "%-16s %-8s %12zu %s %s\n", asset->owner, asset->kind, asset->bytes, asset->vram ? "VRAM" : "RAM ", asset->name);
+	}
+	for (struct AssetShare *share = registry->shares; share; share = share->next) {
+		struct Asset *asset = FindAsset(registry, share->ptr);
+		fprintf(file, "%-16s %-8s %12zu %s %s (%d references)\n", share->owner, asset->kind, asset->bytes, asset->vram ? "VRAM" : "RAM ", asset->name, share->refs);
+	}
+	fclose(file);
+}
+
+void DestroyRegistry(struct Registry *registry, const char *filename) {
+	// By now every gamestate has been unloaded, so whatever is left has leaked.
+	if (registry->dump) {
+		Dump(registry, filename);
+	}
+	while (registry->assets) {
+		struct Asset *asset = registry->assets;
+		registry->assets = asset->next;
+		fprintf(stderr, "LEAK: %s %s %s is still registered on exit!\n", asset->owner, asset->kind, asset->name);
+		free(asset);
+	}
+	while (registry->shares) {
+		struct AssetShare *share = registry->shares;
+		registry->shares = share->next;
+		fprintf(stderr, "LEAK: %s still holds %d references to a cached asset on exit!\n", share->owner, share->refs);
+		free(share);
+	}
+	while (registry->owners) {
+		struct AssetOwner *tmp = registry->owners;
+		registry->owners = tmp->next;
+		free(tmp);
+	}
+	free(registry);
+}
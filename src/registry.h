@@ -0,0 +1,93 @@
+/*! \file registry.h
+ *  \brief Accounting of the memory held by assets.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BLINDDATE_REGISTRY_H
+#define BLINDDATE_REGISTRY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <allegro5/allegro.h>
+#include <allegro5/allegro_font.h>
+#include <allegro5/allegro_audio.h>
+
+struct Game;
+
+/*! \brief Asset tracked by the registry. */
+struct Asset {
+		void *ptr;
+		const char *owner; /*!< Gamestate name, has to be a string literal. */
+		const char *kind;
+		char name[64]; /*!< End of the file path or a short description. */
+		size_t bytes;
+		bool vram;
+		struct Asset *next;
+};
+
+/*! \brief Totals of a single owner. */
+struct AssetOwner {
+		const char *owner;
+		int count;
+		size_t ram, vram, peak_ram, peak_vram;
+		struct AssetOwner *next;
+};
+
+/*! \brief References an owner holds to an asset registered under another one, like the cache. */
+struct AssetShare {
+		void *ptr;
+		const char *owner; /*!< Gamestate name, has to be a string literal. */
+		int refs;
+		struct AssetShare *next;
+};
+
+/*! \brief Sizes of every asset the gamestates registered, so the memory they hold can be reported.
+ *
+ * Assets are expected to be registered and unregistered only from the display
+ * thread; whatever the loader decodes is tracked once it's been handed back. */
+struct Registry {
+		struct Asset *assets;
+		struct AssetShare *shares; /*!< Counted in the totals of their owners, but not in the overall one. */
+		struct AssetOwner *owners;
+		struct AssetOwner total;
+		bool dump; /*!< Write the dump file when destroyed. */
+};
+
+struct Registry* CreateRegistry(bool dump);
+void DestroyRegistry(struct Registry *registry, const char *filename);
+
+ALLEGRO_BITMAP* TrackBitmap(struct Game *game, const char *owner, const char *name, ALLEGRO_BITMAP *bitmap);
+ALLEGRO_FONT* TrackFont(struct Game *game, const char *owner, char *filename, ALLEGRO_FONT *font);
+ALLEGRO_SAMPLE* TrackSample(struct Game *game, const char *owner, const char *name, ALLEGRO_SAMPLE *sample);
+ALLEGRO_AUDIO_STREAM* TrackStream(struct Game *game, const char *owner, const char *name, ALLEGRO_AUDIO_STREAM *stream);
+void UntrackAsset(struct Game *game, void *ptr);
+void ShareAsset(struct Game *game, const char *owner, void *ptr);
+void UnshareAsset(struct Game *game, const char *owner, void *ptr);
+
+void DestroyTrackedBitmap(struct Game *game, ALLEGRO_BITMAP *bitmap);
+void DestroyTrackedFont(struct Game *game, ALLEGRO_FONT *font);
+void DestroyTrackedSample(struct Game *game, ALLEGRO_SAMPLE *sample);
+void DestroyTrackedStream(struct Game *game, ALLEGRO_AUDIO_STREAM *stream);
+
+size_t GetAssetBytes(struct Game *game, void *ptr);
+int CountAssets(struct Game *game, const char *owner, const char *kind);
+void ReportAssets(struct Game *game, const char *owner);
+void CheckAssetLeaks(struct Game *game, const char *owner);
+
+#endif
@@ -0,0 +1,116 @@
+/*! \file static.c
+ *  \brief Serves the statically linked gamestates to libsuperderpy in place of dlopen.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <dlfcn.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <allegro5/allegro.h>
+#include "defines.h"
+#include "latency.h"
+#include "static.h"
+
+// Linked with -Wl,--wrap=dlopen,--wrap=dlsym,--wrap=dlclose,--wrap=dlerror (see src/CMakeLists.txt; the top-level
+// one checks that the linker has it), so every call libsuperderpy makes lands here first. It opens a gamestate
+// as "libsuperderpy-<game>-<name>" plus the platform's library extension, with or without a directory in front;
+// anything else goes to the real thing.
+
+void* __real_dlopen(const char *filename, int flags);
+void* __real_dlsym(void *handle, const char *symbol);
+int __real_dlclose(void *handle);
+char* __real_dlerror(void);
+
+void* __wrap_dlopen(const char *filename, int flags);
+void* __wrap_dlsym(void *handle, const char *symbol);
+int __wrap_dlclose(void *handle);
+char* __wrap_dlerror(void);
+
+static char error[256];
+static bool failed;
+
+static const struct StaticGamestate* FindGamestate(const char *filename) {
+	const char *prefix = "libsuperderpy-" LIBSUPERDERPY_GAMENAME "-";
+	const char *name = filename;
+	for (const char *c = filename; *c; c++) {
+		if ((*c == '/') || (*c == '\\')) {
+			name = c + 1;
+		}
+	}
+	if (strncmp(name, prefix, strlen(prefix))) {
+		return NULL;
+	}
+	name += strlen(prefix);
+	return FindStaticGamestate(name, strcspn(name, "."));
+}
+
+static const struct StaticGamestate* GetGamestate(void *handle) {
+	for (const struct StaticGamestate *gamestate = StaticGamestates; gamestate->name; gamestate++) {
+		if (handle == gamestate) {
+			return gamestate;
+		}
+	}
+	return NULL;
+}
+
+void* __wrap_dlopen(const char *filename, int flags) {
+	const struct StaticGamestate *gamestate = filename ? FindGamestate(filename) : NULL;
+	if (gamestate) {
+		return (void*)gamestate;
+	}
+	return __real_dlopen(filename, flags);
+}
+
+void* __wrap_dlsym(void *handle, const char *symbol) {
+	const struct StaticGamestate *gamestate = GetGamestate(handle);
+	if (!gamestate) {
+		return __real_dlsym(handle, symbol);
+	}
+	void *ptr = FindStaticSymbol(gamestate, symbol);
+	if (!ptr) {
+		snprintf(error, sizeof(error), "%s: undefined symbol: %s", gamestate->name, symbol);
+		failed = true;
+	}
+	return ptr;
+}
+
+int __wrap_dlclose(void *handle) {
+	// nothing to unload, it all stays in the executable
+	return GetGamestate(handle) ? 0 : __real_dlclose(handle);
+}
+
+char* __wrap_dlerror(void) {
+	if (failed) {
+		failed = false;
+		return error;
+	}
+	return __real_dlerror();
+}
+
+#ifdef BLINDDATE_LATENCY
+// also wrapped when measuring the latency, as there's no better place to tell when a frame got shown;
+// interpose.c does the same in the other builds
+void __real_al_flip_display(void);
+void __wrap_al_flip_display(void);
+
+void __wrap_al_flip_display(void) {
+	__real_al_flip_display();
+	LATENCY_SHOWN(al_get_time());
+}
+#endif
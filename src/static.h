@@ -0,0 +1,48 @@
+/*! \file static.h
+ *  \brief Gamestates linked right into the executable.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BLINDDATE_STATIC_H
+#define BLINDDATE_STATIC_H
+
+#include <stddef.h>
+
+/*! \brief Exported name of a statically linked gamestate, as dlsym would find it. */
+struct StaticSymbol {
+		const char *name;
+		void *ptr;
+};
+
+/*! \brief Gamestate built into the executable with -DBLINDDATE_STATIC=ON.
+ *
+ * The table is generated by src/gamestates/CMakeLists.txt, which builds each
+ * gamestate through a wrapper prefixing its exported names, so that all of them
+ * fit in one binary. static.c hands the entries out in place of the libraries
+ * libsuperderpy would otherwise dlopen. */
+struct StaticGamestate {
+		const char *name;
+		const struct StaticSymbol *symbols; /*!< Terminated by an entry with a NULL name. */
+};
+
+extern const struct StaticGamestate StaticGamestates[]; /*!< Terminated by an entry with a NULL name. */
+
+const struct StaticGamestate* FindStaticGamestate(const char *name, size_t length);
+void* FindStaticSymbol(const struct StaticGamestate *gamestate, const char *symbol);
+
+#endif
@@ -0,0 +1,476 @@
+/*! \file dialoguec.c
+ *  \brief Compiles the dialogue script into the binary table loaded by the date gamestate.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../dialogue.h"
+
+#define MAX_STAGES 16
+#define MAX_OPS 1024
+#define MAX_STRINGS 512
+#define MAX_DEPTH 8
+#define MAX_TOKENS 4
+
+static const char *facts[DIALOGUE_FACT_COUNT] = { "name", "weakness", "bitten", "crocodile" };
+static const char *symbols[DIALOGUE_SYMBOL_COUNT] = { "n", "heart", "berry", "warthog" };
+static const char *nodes[DIALOGUE_NODE_COUNT] = { "intro", "won", "lost" };
+
+struct Op {
+		unsigned char opcode, arg;
+		uint16_t a, b;
+};
+
+struct Stage {
+		float score1, score2;
+		uint16_t node[DIALOGUE_NODE_COUNT];
+		int line[DIALOGUE_NODE_COUNT]; // where each node starts, for the errors found once all of them are known
+};
+
+struct Block {
+		int jump; // conditional jump to patch at else/endif
+		int skip; // jump over the else branch, or -1
+		bool has_else;
+};
+
+static struct {
+		const char *filename;
+		int line;
+
+		struct Stage stages[MAX_STAGES];
+		int stage_count;
+
+		struct Op ops[MAX_OPS];
+		int op_count;
+
+		char *strings[MAX_STRINGS];
+		int string_count;
+
+		struct Block blocks[MAX_DEPTH];
+		int depth;
+		bool in_node;
+} c;
+
+static void Error(const char *fmt, ...) {
+	va_list args;
+	fprintf(stderr, "%s:%d: error: ", c.filename, c.line);
+	va_start(args, fmt);
+	vfprintf(stderr, fmt, args);
+	va_end(args);
+	fprintf(stderr, "\n");
+	exit(1);
+}
+
+static int Lookup(const char *name, const char **table, int count, const char *what) {
+	for (int i = 0; i < count; i++) {
+		if (!strcmp(name, table[i])) {
+			return i;
+		}
+	}
+	Error("unknown %s '%s'", what, name);
+	return -1;
+}
+
+static uint16_t AddString(const char *str) {
+	for (int i = 0; i < c.string_count; i++) {
+		if (!strcmp(c.strings[i], str)) {
+			return i;
+		}
+	}
+	if (c.string_count == MAX_STRINGS) {
+		Error("too many strings");
+	}
+	c.strings[c.string_count] = strdup(str);
+	return c.string_count++;
+}
+
+static int Emit(unsigned char opcode, unsigned char arg, uint16_t a, uint16_t b) {
+	if (c.op_count == MAX_OPS) {
+		Error("too many ops");
+	}
+	c.ops[c.op_count] = (struct Op){ .opcode = opcode, .arg = arg, .a = a, .b = b };
+	return c.op_count++;
+}
+
+static void CloseNode(void) {
+	if (!c.in_node) {
+		return;
+	}
+	if (c.depth) {
+		Error("missing endif");
+	}
+	Emit(DIALOGUE_OP_RETURN, 0, 0, 0);
+	c.in_node = false;
+}
+
+static struct Stage* CurrentStage(void) {
+	if (!c.stage_count) {
+		Error("expected 'stage' first");
+	}
+	return &c.stages[c.stage_count - 1];
+}
+
+// Splits a line into whitespace separated words and at most one quoted string, which always comes last.
+static int Tokenize(char *line, char **tokens, char **text) {
+	int count = 0;
+	*text = NULL;
+	char *p = line;
+	while (*p) {
+		while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+			p++;
+		}
+		if (!*p || *p == '#') {
+			break;
+		}
+		if (*p == '"') {
+			char *out = ++p;
+			*text = out;
+			while (*p && *p != '"') {
+				if (*p == '\\' && p[1]) {
+					p++;
+				}
+				*out++ = *p++;
+			}
+			if (*p != '"') {
+				Error("unterminated string");
+			}
+			*out = 0;
+			p++;
+			while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n') {
+				p++;
+			}
+			if (*p && *p != '#') {
+				Error("unexpected input after string");
+			}
+			break;
+		}
+		if (count == MAX_TOKENS) {
+			Error("too many words");
+		}
+		tokens[count++] = p;
+		while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n' && *p != '"') {
+			p++;
+		}
+		if (*p == '"') {
+			continue;
+		}
+		if (*p) {
+			*p++ = 0;
+		}
+	}
+	return count;
+}
+
+static void ExpectTokens(int count, int min, int max, const char *command) {
+	if (count < min || count > max) {
+		Error("wrong number of arguments for '%s'", command);
+	}
+}
+
+static void ParseLine(char *line) {
+	char *tokens[MAX_TOKENS], *text;
+	int count = Tokenize(line, tokens, &text);
+	if (!count) {
+		if (text) {
+			Error("unexpected string");
+		}
+		return;
+	}
+	const char *cmd = tokens[0];
+
+	// "stage <n>" starts a new stage, "stage +1"/"stage -1" is a command inside a node
+	if (!strcmp(cmd, "stage") && count == 2 && tokens[1][0] != '+' && tokens[1][0] != '-') {
+		CloseNode();
+		if (c.stage_count == MAX_STAGES) {
+			Error("too many stages");
+		}
+		if (atoi(tokens[1]) != c.stage_count + 1) {
+			Error("stages have to be numbered consecutively from 1");
+		}
+		struct Stage *stage = &c.stages[c.stage_count++];
+		for (int i = 0; i < DIALOGUE_NODE_COUNT; i++) {
+			stage->node[i] = DIALOGUE_NONE;
+		}
+		stage->score1 = 1;
+		stage->score2 = 1;
+		return;
+	}
+
+	if (!strcmp(cmd, "threshold")) {
+		ExpectTokens(count, 3, 3, cmd);
+		struct Stage *stage = CurrentStage();
+		stage->score1 = atof(tokens[1]);
+		stage->score2 = atof(tokens[2]);
+		if (stage->score1 < 0 || stage->score1 > 1 || stage->score2 < 0 || stage->score2 > 1) {
+			Error("thresholds have to be between 0 and 1");
+		}
+		return;
+	}
+
+	for (int i = 0; i < DIALOGUE_NODE_COUNT; i++) {
+		if (!strcmp(cmd, nodes[i])) {
+			ExpectTokens(count, 1, 1, cmd);
+			CloseNode();
+			struct Stage *stage = CurrentStage();
+			if (stage->node[i] != DIALOGUE_NONE) {
+				Error("duplicate '%s' node", cmd);
+			}
+			stage->node[i] = c.op_count;
+			stage->line[i] = c.line;
+			c.in_node = true;
+			return;
+		}
+	}
+
+	if (!c.in_node) {
+		Error("'%s' outside of a node", cmd);
+	}
+
+	if (!strcmp(cmd, "greg") || !strcmp(cmd, "player")) {
+		ExpectTokens(count, 2, 2, cmd);
+		uint16_t voice = AddString(tokens[1]);
+		Emit(DIALOGUE_OP_SAY, strcmp(cmd, "greg") ? DIALOGUE_SPEAKER_PLAYER : DIALOGUE_SPEAKER_GREG,
+		     voice, text ? AddString(text) : DIALOGUE_NONE);
+		return;
+	}
+
+	if (text) {
+		Error("'%s' takes no string", cmd);
+	}
+
+	if (!strcmp(cmd, "if")) {
+		ExpectTokens(count, 2, 3, cmd);
+		bool negate = (count == 3);
+		if (negate && strcmp(tokens[1], "not")) {
+			Error("expected 'if [not] <fact>'");
+		}
+		if (c.depth == MAX_DEPTH) {
+			Error("conditions nested too deep");
+		}
+		int fact = Lookup(tokens[count - 1], facts, DIALOGUE_FACT_COUNT, "fact");
+		c.blocks[c.depth++] = (struct Block){
+			.jump = Emit(negate ? DIALOGUE_OP_JUMP_IF : DIALOGUE_OP_JUMP_UNLESS, fact, 0, 0),
+			.skip = -1
+		};
+	} else if (!strcmp(cmd, "else")) {
+		ExpectTokens(count, 1, 1, cmd);
+		if (!c.depth || c.blocks[c.depth - 1].has_else) {
+			Error("'else' without 'if'");
+		}
+		struct Block *block = &c.blocks[c.depth - 1];
+		block->skip = Emit(DIALOGUE_OP_JUMP, 0, 0, 0);
+		block->has_else = true;
+		c.ops[block->jump].a = c.op_count;
+	} else if (!strcmp(cmd, "endif")) {
+		ExpectTokens(count, 1, 1, cmd);
+		if (!c.depth) {
+			Error("'endif' without 'if'");
+		}
+		struct Block *block = &c.blocks[--c.depth];
+		if (block->has_else) {
+			c.ops[block->skip].a = c.op_count;
+		} else {
+			c.ops[block->jump].a = c.op_count;
+		}
+	} else if (!strcmp(cmd, "set")) {
+		ExpectTokens(count, 2, 2, cmd);
+		Emit(DIALOGUE_OP_SET, Lookup(tokens[1], facts, DIALOGUE_FACT_COUNT, "fact"), 0, 0);
+	} else if (!strcmp(cmd, "draw")) {
+		ExpectTokens(count, 2, 2, cmd);
+		Emit(DIALOGUE_OP_DRAW, Lookup(tokens[1], symbols, DIALOGUE_SYMBOL_COUNT, "symbol"), 0, 0);
+	} else if (!strcmp(cmd, "stage")) {
+		ExpectTokens(count, 2, 2, cmd);
+		int delta = atoi(tokens[1]);
+		if (delta < -127 || delta > 127) {
+			Error("stage change out of range");
+		}
+		Emit(DIALOGUE_OP_STAGE, (unsigned char)(signed char)delta, 0, 0);
+	} else if (!strcmp(cmd, "nextstage")) {
+		ExpectTokens(count, 1, 1, cmd);
+		Emit(DIALOGUE_OP_NEXTSTAGE, 0, 0, 0);
+	} else if (!strcmp(cmd, "decide")) {
+		ExpectTokens(count, 1, 1, cmd);
+		Emit(DIALOGUE_OP_DECIDE, 0, 0, 0);
+	} else if (!strcmp(cmd, "end")) {
+		ExpectTokens(count, 1, 1, cmd);
+		Emit(DIALOGUE_OP_END, 0, 0, 0);
+	} else {
+		Error("unknown command '%s'", cmd);
+	}
+}
+
+// Walks every path through a node, starting in the given stage, and marks the intros it can get to through
+// "decide" without saying a line or asking for a drawing first. Facts that aren't set on the path may be either.
+static void FindSilentDecides(int pc, int stage, unsigned facts, bool *reached) {
+	while (true) {
+		struct Op *op = &c.ops[pc++];
+		switch (op->opcode) {
+			case DIALOGUE_OP_RETURN:
+			case DIALOGUE_OP_END:
+			case DIALOGUE_OP_SAY:
+			case DIALOGUE_OP_DRAW:
+				return;
+			case DIALOGUE_OP_JUMP:
+				pc = op->a;
+				break;
+			case DIALOGUE_OP_JUMP_IF:
+			case DIALOGUE_OP_JUMP_UNLESS:
+				if (!(facts & (1u << op->arg))) {
+					// only known to be set when it's been set on the way here, otherwise both ways are walked
+					FindSilentDecides(op->a, stage, facts, reached);
+				} else if (op->opcode == DIALOGUE_OP_JUMP_IF) {
+					pc = op->a;
+				}
+				break;
+			case DIALOGUE_OP_SET:
+				facts |= 1u << op->arg;
+				break;
+			case DIALOGUE_OP_STAGE:
+				stage += (signed char)op->arg;
+				break;
+			case DIALOGUE_OP_NEXTSTAGE:
+				stage++; // queued before the decide, so it's applied by the time that one runs
+				break;
+			case DIALOGUE_OP_DECIDE:
+				if ((stage >= 1) && (stage <= c.stage_count) && (c.stages[stage - 1].node[DIALOGUE_NODE_INTRO] != DIALOGUE_NONE)) {
+					reached[stage - 1] = true;
+				}
+				break;
+		}
+	}
+}
+
+static bool HasSilentLoop(int stage, bool (*edges)[MAX_STAGES], int *state) {
+	// depth-first, state is 0 when unvisited, 1 while on the current path and 2 when done
+	state[stage] = 1;
+	for (int i = 0; i < c.stage_count; i++) {
+		if (edges[stage][i] && ((state[i] == 1) || (!state[i] && HasSilentLoop(i, edges, state)))) {
+			return true;
+		}
+	}
+	state[stage] = 2;
+	return false;
+}
+
+static void CheckLoops(void) {
+	// An intro that can come back to itself with nothing to wait for in between would keep the timeline
+	// spinning forever, so that's rejected here instead of hanging the game.
+	for (int i = 0; i < c.op_count; i++) {
+		if ((c.ops[i].opcode >= DIALOGUE_OP_JUMP) && (c.ops[i].opcode <= DIALOGUE_OP_JUMP_UNLESS) && (c.ops[i].a <= i)) {
+			Error("backward jump at op %d", i); // never emitted for if/else/endif, and the walk relies on it
+		}
+	}
+	bool edges[MAX_STAGES][MAX_STAGES] = {{false}};
+	for (int i = 0; i < c.stage_count; i++) {
+		if (c.stages[i].node[DIALOGUE_NODE_INTRO] != DIALOGUE_NONE) {
+			FindSilentDecides(c.stages[i].node[DIALOGUE_NODE_INTRO], i + 1, 0, edges[i]);
+		}
+	}
+	for (int i = 0; i < c.stage_count; i++) {
+		int state[MAX_STAGES] = {0};
+		if (HasSilentLoop(i, edges, state)) {
+			c.line = c.stages[i].line[DIALOGUE_NODE_INTRO];
+			Error("intro of stage %d can get back to itself through 'decide' without a line or a drawing in between", i + 1);
+		}
+	}
+}
+
+static void WriteU16(FILE *f, uint16_t v) {
+	fputc(v & 0xFF, f);
+	fputc(v >> 8, f);
+}
+
+static void WriteU32(FILE *f, uint32_t v) {
+	WriteU16(f, v & 0xFFFF);
+	WriteU16(f, v >> 16);
+}
+
+static uint16_t Threshold(float score) {
+	return (uint16_t)(score * 1000 + 0.5);
+}
+
+int main(int argc, char **argv) {
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s <script> <output>\n", argv[0]);
+		return 1;
+	}
+
+	c.filename = argv[1];
+	FILE *in = fopen(argv[1], "r");
+	if (!in) {
+		perror(argv[1]);
+		return 1;
+	}
+	char line[1024];
+	while (fgets(line, sizeof(line), in)) {
+		c.line++;
+		if (!strchr(line, '\n') && !feof(in)) {
+			Error("line too long");
+		}
+		ParseLine(line);
+	}
+	fclose(in);
+	CloseNode();
+	CheckLoops();
+
+	uint32_t string_bytes = 0;
+	for (int i = 0; i < c.string_count; i++) {
+		string_bytes += strlen(c.strings[i]) + 1;
+	}
+
+	FILE *out = fopen(argv[2], "wb");
+	if (!out) {
+		perror(argv[2]);
+		return 1;
+	}
+	fwrite(DIALOGUE_MAGIC, 1, 4, out);
+	WriteU16(out, DIALOGUE_VERSION);
+	WriteU16(out, c.stage_count);
+	WriteU16(out, c.op_count);
+	WriteU16(out, c.string_count);
+	WriteU32(out, string_bytes);
+	for (int i = 0; i < c.stage_count; i++) {
+		WriteU16(out, Threshold(c.stages[i].score1));
+		WriteU16(out, Threshold(c.stages[i].score2));
+		for (int j = 0; j < DIALOGUE_NODE_COUNT; j++) {
+			WriteU16(out, c.stages[i].node[j]);
+		}
+	}
+	for (int i = 0; i < c.op_count; i++) {
+		fputc(c.ops[i].opcode, out);
+		fputc(c.ops[i].arg, out);
+		WriteU16(out, c.ops[i].a);
+		WriteU16(out, c.ops[i].b);
+	}
+	for (int i = 0; i < c.string_count; i++) {
+		fwrite(c.strings[i], 1, strlen(c.strings[i]) + 1, out);
+	}
+	if (fclose(out)) {
+		perror(argv[2]);
+		return 1;
+	}
+
+	printf("%s: %d stages, %d ops, %d strings (%u bytes)\n", argv[2], c.stage_count, c.op_count, c.string_count, string_bytes);
+	return 0;
+}
@@ -0,0 +1,122 @@
+/*! \file trace.c
+ *  \brief Startup and load tracing in Chrome trace format.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "trace.h"
+
+#ifdef BLINDDATE_TRACE
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define TRACE_EVENTS 16384
+#define TRACE_ARG_SIZE 48
+
+struct TraceRecord {
+		const char *name;
+		double ts; // microseconds
+		int tid;
+		char phase;
+		char arg[TRACE_ARG_SIZE];
+};
+
+static struct TraceRecord events[TRACE_EVENTS];
+static int event_count, dropped, threads;
+static __thread int tid;
+
+static double Now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000.0 + ts.tv_nsec / 1000.0;
+}
+
+void TraceEvent(char phase, const char *name, const char *arg) {
+	int i = __sync_fetch_and_add(&event_count, 1);
+	if (i >= TRACE_EVENTS) {
+		__sync_fetch_and_add(&dropped, 1);
+		return;
+	}
+	if (!tid) {
+		tid = __sync_add_and_fetch(&threads, 1);
+	}
+	struct TraceRecord *event = &events[i];
+	event->ts = Now();
+	event->name = name;
+	event->phase = phase;
+	event->tid = tid;
+	if (arg) {
+		// the end of a path is what tells the events apart
+		size_t len = strlen(arg);
+		strcpy(event->arg, (len < TRACE_ARG_SIZE) ? arg : arg + len - TRACE_ARG_SIZE + 1);
+	} else {
+		event->arg[0] = 0;
+	}
+}
+
+static void WriteString(FILE *file, const char *str) {
+	fputc('"', file);
+	for (; *str; str++) {
+		if ((*str == '"') || (*str == '\\')) {
+			fputc('\\', file);
+		}
+		fputc(*str, file);
+	}
+	fputc('"', file);
+}
+
+void TraceWrite(const char *filename) {
+	// Called once everything else has finished, so no events are being recorded anymore.
+	FILE *file = fopen(filename, "w");
+	if (!file) {
+		fprintf(stderr, "Could not write trace to %s!\n", filename);
+		return;
+	}
+	int count = (event_count < TRACE_EVENTS) ? event_count : TRACE_EVENTS;
+	double start = count ? events[0].ts : 0;
+	for (int i = 1; i < count; i++) {
+		if (events[i].ts < start) {
+			start = events[i].ts;
+		}
+	}
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+	for (int i = 0; i < count; i++) {
+		struct TraceRecord *event = &events[i];
+		fprintf(file, "%s\n{\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d", i ? "," : "", event->phase, event->ts - start, event->tid);
+		if (event->phase == 'i') {
+			fprintf(file, ",\"s\":\"p\"");
+		}
+		if (event->name) {
+			fprintf(file, ",\"name\":");
+			WriteString(file, event->name);
+		}
+		if (event->arg[0]) {
+			fprintf(file, ",\"args\":{\"path\":");
+			WriteString(file, event->arg);
+			fputc('}', file);
+		}
+		fputc('}', file);
+	}
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	fprintf(stderr, "Trace with %d events written to %s (%d dropped).\n", count, filename, dropped);
+}
+
+#endif
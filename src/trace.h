@@ -0,0 +1,56 @@
+/*! \file trace.h
+ *  \brief Startup and load tracing in Chrome trace format.
+ */
+/*
+ * Copyright (c) Sebastian Krzyszkowiak <dos@dosowisko.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef BLINDDATE_TRACE_H
+#define BLINDDATE_TRACE_H
+
+/* Tracing is compiled in only with the BLINDDATE_TRACE CMake option. Without
+ * it, every macro below expands to nothing.
+ *
+ * Events go to a preallocated buffer, so recording one costs a clock read and
+ * an atomic increment. The buffer is written out as JSON by TRACE_WRITE and
+ * can be opened in chrome://tracing or Perfetto. Names have to be string
+ * literals, because only the pointer is stored. */
+
+#ifdef BLINDDATE_TRACE
+
+#include <stddef.h>
+
+void TraceEvent(char phase, const char *name, const char *arg);
+void TraceWrite(const char *filename);
+
+#define TRACE_BEGIN(name) TraceEvent('B', name, NULL)
+#define TRACE_BEGIN_ARG(name, arg) TraceEvent('B', name, arg) /*!< arg is copied, so it may be any string. */
+#define TRACE_END() TraceEvent('E', NULL, NULL)
+#define TRACE_INSTANT(name) TraceEvent('i', name, NULL)
+#define TRACE_WRITE(filename) TraceWrite(filename)
+
+#else
+
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_BEGIN_ARG(name, arg) ((void)0)
+#define TRACE_END() ((void)0)
+#define TRACE_INSTANT(name) ((void)0)
+#define TRACE_WRITE(filename) ((void)0)
+
+#endif
+
+#endif